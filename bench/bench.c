@@ -0,0 +1,461 @@
+#include "portfolio.h"
+#include "prover.h"
+#include "writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * mp-bench: proves generated tautology families of growing size with each
+ * search strategy and writes one CSV row (or JSON line) per run, for
+ * scaling curves. Every run is bounded by +max-time; a family stops growing
+ * for a strategy once that strategy gives up on it. peak_rss_kb is the
+ * process high-water mark after the run, so it only grows within one
+ * invocation.
+ *
+ *   mp-bench axioms-file [+family=chain,contra,dneg,random] [+max-n=N]
+ *            [+atoms=K] [+count=C] [+seed=S] [+max-time=MS]
+ *            [+strategies=base,neg,self_impl,rules,shortest,portfolio]
+ *            [+json]
+ */
+
+#define MAX_ATOMS 26
+#define RANDOM_TRIES 10000
+
+typedef enum {
+    STRATEGY_BASE,
+    STRATEGY_NEG,
+    STRATEGY_SELF_IMPL,
+    STRATEGY_RULES,
+    STRATEGY_SHORTEST,
+    STRATEGY_PORTFOLIO,
+    STRATEGY_COUNT
+} strategy_t;
+
+static const char *strategy_names[STRATEGY_COUNT] = {
+    "base", "neg", "self_impl", "rules", "shortest", "portfolio"
+};
+
+typedef enum {
+    FAMILY_CHAIN,
+    FAMILY_CONTRA,
+    FAMILY_DNEG,
+    FAMILY_RANDOM,
+    FAMILY_COUNT
+} family_t;
+
+static const char *family_names[FAMILY_COUNT] = {
+    "chain", "contra", "dneg", "random"
+};
+
+static int max_n = 8;
+static int atoms = 3;
+static int count = 3;
+static uint64_t seed = 1;
+static long max_time_ms = 2000;
+static int json = 0;
+
+/*
+ * Implication chain: (a => b), (b => c), ... |- (a => x_n), curried into
+ * one formula.
+ */
+static void Chain(writer_t *w, int n)
+{
+    for (int i = 0; i + 1 < n; i++) {
+        Writer_Str(w, "((");
+        Writer_Char(w, 'a' + i);
+        Writer_Str(w, " => ");
+        Writer_Char(w, 'a' + i + 1);
+        Writer_Str(w, ") => ");
+    }
+    Writer_Str(w, "(a => ");
+    Writer_Char(w, 'a' + n - 1);
+    Writer_Char(w, ')');
+    Writer_Pad(w, ')', n - 1);
+}
+
+/* F(1) = ((!q => !p) => (p => q)), F(n) = ((!F(n-1) => !p) => (p => F(n-1))). */
+static void Contra(writer_t *w, int n)
+{
+    if (n <= 0) {
+        Writer_Char(w, 'q');
+        return;
+    }
+    Writer_Str(w, "((!");
+    Contra(w, n - 1);
+    Writer_Str(w, " => !p) => (p => ");
+    Contra(w, n - 1);
+    Writer_Str(w, "))");
+}
+
+/* (!!...!!p => p) with 2n negations. */
+static void DoubleNeg(writer_t *w, int n)
+{
+    Writer_Char(w, '(');
+    Writer_Pad(w, '!', 2 * n);
+    Writer_Str(w, "p => p)");
+}
+
+typedef struct {
+    char op;
+    int a, b;
+} node_t;
+
+typedef struct {
+    node_t nodes[256];
+    int count;
+} formula_t;
+
+static uint64_t Random(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+}
+
+/* A random formula with size connectives over the first atoms atoms. */
+static int Generate(formula_t *f, int size)
+{
+    node_t *node = &f->nodes[f->count];
+    int idx = f->count++;
+
+    if (size == 0) {
+        node->op = 'a' + Random() % atoms;
+    }
+    else if (Random() % 3 == 0) {
+        node->op = '!';
+        node->a = Generate(f, size - 1);
+    }
+    else {
+        int left = Random() % size;
+        node->op = '>';
+        node->a = Generate(f, left);
+        node->b = Generate(f, size - 1 - left);
+    }
+    return idx;
+}
+
+static bool Eval(formula_t *f, int i, unsigned assignment)
+{
+    node_t *node = &f->nodes[i];
+    switch (node->op) {
+    case '!': return !Eval(f, node->a, assignment);
+    case '>': return !Eval(f, node->a, assignment) || Eval(f, node->b, assignment);
+    default:  return (assignment >> (node->op - 'a')) & 1;
+    }
+}
+
+static void Render(writer_t *w, formula_t *f, int i)
+{
+    node_t *node = &f->nodes[i];
+    switch (node->op) {
+    case '!':
+        Writer_Char(w, '!');
+        Render(w, f, node->a);
+        break;
+    case '>':
+        Writer_Char(w, '(');
+        Render(w, f, node->a);
+        Writer_Str(w, " => ");
+        Render(w, f, node->b);
+        Writer_Char(w, ')');
+        break;
+    default:
+        Writer_Char(w, node->op);
+    }
+}
+
+/* A random tautology with n connectives, found by truth tables. */
+static bool RandomTautology(writer_t *w, int n)
+{
+    for (int tries = 0; tries < RANDOM_TRIES; tries++) {
+        formula_t f;
+        f.count = 0;
+        Generate(&f, n);
+
+        bool valid = true;
+        for (unsigned assignment = 0; valid && assignment < (1u << atoms); assignment++) {
+            valid = Eval(&f, 0, assignment);
+        }
+        if (valid) {
+            Render(w, &f, 0);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool Family(writer_t *w, family_t family, int n)
+{
+    switch (family) {
+    case FAMILY_CHAIN:  if (n < 2 || n > MAX_ATOMS) return false; Chain(w, n); return true;
+    case FAMILY_CONTRA: Contra(w, n); return true;
+    case FAMILY_DNEG:   DoubleNeg(w, n); return true;
+    default:            return n < 128 && RandomTautology(w, n);
+    }
+}
+
+typedef struct {
+    prover_ctx_t *ctx;
+    portfolio_t portfolio;
+    bool is_portfolio;
+} runner_t;
+
+static int Runner_Init(runner_t *r, strategy_t strategy, const char *axioms_path)
+{
+    prover_options_t opts;
+    Prover_DefaultOptions(&opts);
+    opts.announce = 0;
+    opts.max_time_ms = max_time_ms;
+    if (strategy == STRATEGY_NEG) opts.add_neg_terms = 1;
+    if (strategy == STRATEGY_SELF_IMPL) opts.add_self_impl = 1;
+    if (strategy == STRATEGY_RULES) opts.enabled_rules = RULES_ALL;
+    if (strategy == STRATEGY_SHORTEST) opts.shortest_proof = 1;
+
+    r->ctx = Prover_Create(&opts);
+    if (Prover_LoadAxioms(r->ctx, axioms_path) < 0) {
+        fprintf(stderr, "failed to open %s\n", axioms_path);
+        Prover_Destroy(r->ctx);
+        return -1;
+    }
+
+    r->is_portfolio = strategy == STRATEGY_PORTFOLIO;
+    if (r->is_portfolio) Portfolio_Init(&r->portfolio, r->ctx);
+    return 0;
+}
+
+static void Runner_Free(runner_t *r)
+{
+    if (r->is_portfolio) Portfolio_Free(&r->portfolio);
+    Prover_Destroy(r->ctx);
+}
+
+typedef struct {
+    prover_status_t status;
+    long wall_us, cpu_us;
+    long peak_exprs, peak_pool;
+    long peak_rss_kb;
+    int steps;
+} result_t;
+
+static long Micros(struct timespec *a, struct timespec *b)
+{
+    return (b->tv_sec - a->tv_sec) * 1000000L + (b->tv_nsec - a->tv_nsec) / 1000;
+}
+
+static void Run(runner_t *r, const char *formula, size_t len, result_t *res)
+{
+    struct timespec wall0, wall1, cpu0, cpu1;
+    prover_stats_t stats;
+    Stats_Init(&stats);
+
+    clock_gettime(CLOCK_MONOTONIC, &wall0);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu0);
+
+    prover_ctx_t *done = r->ctx;
+    if (r->is_portfolio) {
+        prover_ctx_t *winner = Portfolio_Prove(&r->portfolio, formula, formula + len);
+        res->status = winner != NULL ? PROVER_FOUND : PROVER_NOT_FOUND;
+        for (int i = 0; i < r->portfolio.count; i++) {
+            prover_ctx_t *ctx = r->portfolio.entrants[i].ctx;
+            if (ctx->status == PROVER_ABORTED && res->status != PROVER_FOUND) res->status = PROVER_ABORTED;
+            Stats_Merge(&stats, &ctx->stats);
+            Stats_Free(&ctx->stats);
+        }
+        if (winner != NULL) done = winner;
+    }
+    else {
+        Prover_SetGoal(r->ctx, formula, formula + len);
+        Prover_Prove(r->ctx);
+        res->status = r->ctx->status;
+        Stats_Merge(&stats, &r->ctx->stats);
+        Stats_Free(&r->ctx->stats);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &wall1);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu1);
+
+    res->wall_us = Micros(&wall0, &wall1);
+    res->cpu_us = Micros(&cpu0, &cpu1);
+    res->peak_exprs = stats.peak_exprs;
+    res->peak_pool = stats.peak_pool;
+    res->steps = res->status == PROVER_FOUND ? Prover_Proof(done)->count : 0;
+    res->peak_rss_kb = Stats_PeakRss();
+
+    if (!r->is_portfolio) Prover_Reset(r->ctx);
+    Stats_Free(&stats);
+}
+
+static const char *StatusName(prover_status_t status)
+{
+    switch (status) {
+    case PROVER_FOUND:   return "proved";
+    case PROVER_ABORTED: return "aborted";
+    default:             return "not_found";
+    }
+}
+
+static void Report(family_t family, int n, int index, strategy_t strategy, result_t *res, writer_t *formula)
+{
+    if (json) {
+        Writer_Str(&out, "{\"family\":\"");
+        Writer_Str(&out, family_names[family]);
+        Writer_Str(&out, "\",\"n\":");
+        Writer_Int(&out, n, 0);
+        Writer_Str(&out, ",\"index\":");
+        Writer_Int(&out, index, 0);
+        Writer_Str(&out, ",\"strategy\":\"");
+        Writer_Str(&out, strategy_names[strategy]);
+        Writer_Str(&out, "\",\"status\":\"");
+        Writer_Str(&out, StatusName(res->status));
+        Writer_Str(&out, "\",\"wall_us\":");
+        Writer_Int(&out, res->wall_us, 0);
+        Writer_Str(&out, ",\"cpu_us\":");
+        Writer_Int(&out, res->cpu_us, 0);
+        Writer_Str(&out, ",\"peak_exprs\":");
+        Writer_Int(&out, res->peak_exprs, 0);
+        Writer_Str(&out, ",\"peak_pool\":");
+        Writer_Int(&out, res->peak_pool, 0);
+        Writer_Str(&out, ",\"proof_steps\":");
+        Writer_Int(&out, res->steps, 0);
+        Writer_Str(&out, ",\"peak_rss_kb\":");
+        Writer_Int(&out, res->peak_rss_kb, 0);
+        Writer_Str(&out, ",\"formula\":\"");
+        Writer_Put(&out, formula->buf, formula->len);
+        Writer_Str(&out, "\"}\n");
+    }
+    else {
+        Writer_Str(&out, family_names[family]);
+        Writer_Char(&out, ',');
+        Writer_Int(&out, n, 0);
+        Writer_Char(&out, ',');
+        Writer_Int(&out, index, 0);
+        Writer_Char(&out, ',');
+        Writer_Str(&out, strategy_names[strategy]);
+        Writer_Char(&out, ',');
+        Writer_Str(&out, StatusName(res->status));
+        Writer_Char(&out, ',');
+        Writer_Int(&out, res->wall_us, 0);
+        Writer_Char(&out, ',');
+        Writer_Int(&out, res->cpu_us, 0);
+        Writer_Char(&out, ',');
+        Writer_Int(&out, res->peak_exprs, 0);
+        Writer_Char(&out, ',');
+        Writer_Int(&out, res->peak_pool, 0);
+        Writer_Char(&out, ',');
+        Writer_Int(&out, res->steps, 0);
+        Writer_Char(&out, ',');
+        Writer_Int(&out, res->peak_rss_kb, 0);
+        Writer_Str(&out, ",\"");
+        Writer_Put(&out, formula->buf, formula->len);
+        Writer_Str(&out, "\"\n");
+    }
+    Writer_Flush(&out);
+}
+
+/* Parses a comma separated list of names into a bit set. Returns -1 on an unknown name. */
+static int ParseList(const char *spec, const char **names, int name_count, unsigned *set)
+{
+    *set = 0;
+    while (*spec != '\0') {
+        const char *end = strchr(spec, ',');
+        size_t len = end != NULL ? (size_t)(end - spec) : strlen(spec);
+
+        int i = 0;
+        while (i < name_count && !(strlen(names[i]) == len && strncmp(names[i], spec, len) == 0)) i++;
+        if (i == name_count) return -1;
+
+        *set |= 1u << i;
+        spec += len + (end != NULL);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    argv++;
+
+    if (*argv == NULL) {
+        printf("specify axioms file\n");
+        return 1;
+    }
+    const char *axioms_path = *argv++;
+
+    unsigned families = (1u << FAMILY_COUNT) - 1;
+    unsigned strategies = (1u << STRATEGY_COUNT) - 1;
+    for (; *argv != NULL; argv++) {
+        if (strncmp(*argv, "+family=", 8) == 0) {
+            if (ParseList(*argv + 8, family_names, FAMILY_COUNT, &families) != 0) {
+                printf("unknown family in %s\n", *argv);
+                return 1;
+            }
+        }
+        else if (strncmp(*argv, "+strategies=", 12) == 0) {
+            if (ParseList(*argv + 12, strategy_names, STRATEGY_COUNT, &strategies) != 0) {
+                printf("unknown strategy in %s\n", *argv);
+                return 1;
+            }
+        }
+        else if (strncmp(*argv, "+max-n=", 7) == 0) max_n = atoi(*argv + 7);
+        else if (strncmp(*argv, "+atoms=", 7) == 0) atoms = atoi(*argv + 7);
+        else if (strncmp(*argv, "+count=", 7) == 0) count = atoi(*argv + 7);
+        else if (strncmp(*argv, "+seed=", 6) == 0) seed = strtoull(*argv + 6, NULL, 10);
+        else if (strncmp(*argv, "+max-time=", 10) == 0) max_time_ms = atol(*argv + 10);
+        else if (strcmp(*argv, "+json") == 0) json = 1;
+        else {
+            printf("unknown option %s\n", *argv);
+            return 1;
+        }
+    }
+    if (atoms < 1 || atoms > MAX_ATOMS) {
+        printf("+atoms must be between 1 and %d\n", MAX_ATOMS);
+        return 1;
+    }
+    if (seed == 0) seed = 1;
+
+    Expr_SetExitReport(false);
+    Writer_Init(&out, 1);
+    if (!json) {
+        Writer_Str(&out, "family,n,index,strategy,status,wall_us,cpu_us,peak_exprs,peak_pool,proof_steps,peak_rss_kb,formula\n");
+    }
+
+    writer_t formula;
+    Writer_Init(&formula, -1);
+
+    /* Every strategy gets the same random formulas. */
+    uint64_t first_seed = seed;
+    for (int s = 0; s < STRATEGY_COUNT; s++) {
+        if (!(strategies & (1u << s))) continue;
+        seed = first_seed;
+
+        runner_t runner;
+        if (Runner_Init(&runner, s, axioms_path) != 0) return 1;
+
+        for (int fam = 0; fam < FAMILY_COUNT; fam++) {
+            if (!(families & (1u << fam))) continue;
+
+            bool gave_up = false;
+            for (int n = 1; n <= max_n && !gave_up; n++) {
+                int instances = fam == FAMILY_RANDOM ? count : 1;
+                for (int index = 0; index < instances; index++) {
+                    formula.len = 0;
+                    if (!Family(&formula, fam, n)) break;
+
+                    result_t res;
+                    Run(&runner, formula.buf, formula.len, &res);
+                    Report(fam, n, index, s, &res, &formula);
+                    gave_up |= res.status == PROVER_ABORTED;
+                }
+            }
+        }
+
+        Runner_Free(&runner);
+    }
+
+    Writer_Free(&formula);
+    Writer_Free(&out);
+    return 0;
+}
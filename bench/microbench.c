@@ -0,0 +1,486 @@
+#include "pool.h"
+#include "writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+ * mp-microbench: times the primitives the search spends its time in, one
+ * CSV row (or JSON line) per primitive and setting. Expression primitives
+ * are swept over formula size (connectives), the pool_map and terms_set
+ * operations over bucket count and occupancy. Cache misses per operation
+ * come from the hardware counters where perf_event_open allows it and are
+ * reported as "-" (null) otherwise.
+ *
+ *   mp-microbench [+sizes=1,4,16,...] [+buckets=1024,16384,...]
+ *                 [+occupancy=25,50,...] [+table-size=N] [+atoms=K]
+ *                 [+work=N] [+seed=S] [+json]
+ */
+
+#define MAX_LIST 16
+#define MAX_ATOMS 26
+#define SUBST_SIZE 4
+
+/* Expressions built per timed batch; the arena is rewound between batches. */
+#define BATCH_NODES (1 << 20)
+
+static long sizes[MAX_LIST] = { 1, 4, 16, 64, 256, 1024 };
+static int size_count = 6;
+static long buckets[MAX_LIST] = { 1024, 16384, 131072 };
+static int bucket_count = 3;
+static long occupancy[MAX_LIST] = { 25, 50, 75, 85 };
+static int occupancy_count = 4;
+static int table_size = 8;
+static int atoms = 8;
+static long work = 1 << 22;
+static uint64_t seed = 1;
+static int json = 0;
+
+static expr_t *leaves[MAX_ATOMS];
+static expr_t *variables[3];
+
+static uint64_t Random(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+}
+
+/* A random formula with size connectives over the given leaves, shaped like mp-bench's. */
+static expr_t *RandomExpr(int size, expr_t **from, int from_count)
+{
+    if (size == 0) return from[Random() % from_count];
+    if (Random() % 3 == 0) return Expr_Not(RandomExpr(size - 1, from, from_count));
+
+    int left = Random() % size;
+    expr_t *a = RandomExpr(left, from, from_count);
+    expr_t *b = RandomExpr(size - 1 - left, from, from_count);
+    return Expr_Implies(a, b);
+}
+
+/* Interned atoms keep their hash, they are shared by every formula. */
+static void ClearHashes(expr_t *e)
+{
+    if (e->type == EXPR_ATOM) return;
+    e->hash = 0;
+    if (e->type == EXPR_IMPLIES) {
+        ClearHashes(e->implies.a);
+        ClearHashes(e->implies.b);
+    }
+    else {
+        ClearHashes(e->not.a);
+    }
+}
+
+typedef struct {
+    int fd;
+    long ns;
+    struct timespec t0;
+} meter_t;
+
+static int OpenCacheCounter(void)
+{
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static void Meter_Reset(meter_t *m)
+{
+    m->ns = 0;
+#ifdef __linux__
+    if (m->fd >= 0) ioctl(m->fd, PERF_EVENT_IOC_RESET, 0);
+#endif
+}
+
+static void Meter_Start(meter_t *m)
+{
+#ifdef __linux__
+    if (m->fd >= 0) ioctl(m->fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &m->t0);
+}
+
+static void Meter_Stop(meter_t *m)
+{
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+#ifdef __linux__
+    if (m->fd >= 0) ioctl(m->fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+    m->ns += (t1.tv_sec - m->t0.tv_sec) * 1000000000L + (t1.tv_nsec - m->t0.tv_nsec);
+}
+
+static long Meter_Misses(meter_t *m)
+{
+    uint64_t count = 0;
+#ifdef __linux__
+    if (m->fd >= 0 && read(m->fd, &count, sizeof(count)) != sizeof(count)) return -1;
+#endif
+    return m->fd >= 0 ? (long)count : -1;
+}
+
+/* Hundredths, as "12.34". */
+static void WriteFixed(writer_t *w, long hundredths)
+{
+    Writer_Int(w, hundredths / 100, 0);
+    Writer_Char(w, '.');
+    if (hundredths % 100 < 10) Writer_Char(w, '0');
+    Writer_Int(w, hundredths % 100, 0);
+}
+
+static void Report(meter_t *m, const char *primitive, long size, long table_buckets, long entries, long ops)
+{
+    long misses = Meter_Misses(m);
+    long ns = ops > 0 ? m->ns * 100 / ops : 0;
+    long occ = table_buckets > 0 ? entries * 10000 / table_buckets : 0;
+
+    if (json) {
+        Writer_Str(&out, "{\"primitive\":\"");
+        Writer_Str(&out, primitive);
+        Writer_Str(&out, "\",\"size\":");
+        Writer_Int(&out, size, 0);
+        Writer_Str(&out, ",\"buckets\":");
+        Writer_Int(&out, table_buckets, 0);
+        Writer_Str(&out, ",\"occupancy\":");
+        WriteFixed(&out, occ);
+        Writer_Str(&out, ",\"ops\":");
+        Writer_Int(&out, ops, 0);
+        Writer_Str(&out, ",\"ns_per_op\":");
+        WriteFixed(&out, ns);
+        Writer_Str(&out, ",\"cache_misses_per_op\":");
+        if (misses >= 0) WriteFixed(&out, ops > 0 ? misses * 100 / ops : 0);
+        else Writer_Str(&out, "null");
+        Writer_Str(&out, "}\n");
+    }
+    else {
+        Writer_Str(&out, primitive);
+        Writer_Char(&out, ',');
+        Writer_Int(&out, size, 0);
+        Writer_Char(&out, ',');
+        Writer_Int(&out, table_buckets, 0);
+        Writer_Char(&out, ',');
+        WriteFixed(&out, occ);
+        Writer_Char(&out, ',');
+        Writer_Int(&out, ops, 0);
+        Writer_Char(&out, ',');
+        WriteFixed(&out, ns);
+        Writer_Char(&out, ',');
+        if (misses >= 0) WriteFixed(&out, ops > 0 ? misses * 100 / ops : 0);
+        else Writer_Char(&out, '-');
+        Writer_Char(&out, '\n');
+    }
+    Writer_Flush(&out);
+}
+
+/* Calls per measurement: work nodes' worth, at least 16. */
+static long Calls(long size)
+{
+    long calls = work / (2 * size + 1);
+    return calls < 16 ? 16 : calls;
+}
+
+/* Calls per batch, so that a batch's results fit the arena. */
+static long Batch(long size, long left)
+{
+    long batch = BATCH_NODES / (2 * size + 1);
+    if (batch < 1) batch = 1;
+    return batch < left ? batch : left;
+}
+
+static void BenchExpr(meter_t *m, long size)
+{
+    expr_mark_t base = Expr_Mark();
+    expr_t *e = RandomExpr(size, leaves, atoms);
+    expr_t *template = RandomExpr(size, variables, 3);
+    expr_t *sub[3];
+    for (int i = 0; i < 3; i++) sub[i] = RandomExpr(SUBST_SIZE, leaves, atoms);
+    expr_mark_t mark = Expr_Mark();
+
+    long calls = Calls(size);
+    expr_t **copies = malloc(Batch(size, calls) * sizeof(expr_t *));
+    if (copies == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    volatile uint64_t sink = 0;
+
+    Meter_Reset(m);
+    for (long done = 0; done < calls;) {
+        long n = Batch(size, calls - done);
+        Meter_Start(m);
+        for (long i = 0; i < n; i++) copies[i] = Expr_Clone(e);
+        Meter_Stop(m);
+        Expr_Release(mark);
+        done += n;
+    }
+    Report(m, "clone", size, 0, 0, calls);
+
+    /* The hash is cached on every node, so this is what lookups pay. */
+    Meter_Reset(m);
+    Meter_Start(m);
+    for (long i = 0; i < calls; i++) sink += Expr_Hash(e);
+    Meter_Stop(m);
+    Report(m, "hash", size, 0, 0, calls);
+
+    /* Full recomputation, with every node's cache cleared beforehand. */
+    Meter_Reset(m);
+    for (long done = 0; done < calls;) {
+        long n = Batch(size, calls - done);
+        for (long i = 0; i < n; i++) {
+            copies[i] = Expr_Clone(e);
+            ClearHashes(copies[i]);
+        }
+        Meter_Start(m);
+        for (long i = 0; i < n; i++) sink += Expr_Hash(copies[i]);
+        Meter_Stop(m);
+        Expr_Release(mark);
+        done += n;
+    }
+    Report(m, "hash_cold", size, 0, 0, calls);
+
+    /* Equal but distinct formulas, so the whole tree is compared. */
+    Meter_Reset(m);
+    for (long done = 0; done < calls;) {
+        long n = Batch(size, calls - done);
+        for (long i = 0; i < n; i++) copies[i] = Expr_Clone(e);
+        Meter_Start(m);
+        for (long i = 0; i < n; i++) sink += Expr_Equal(e, copies[i]);
+        Meter_Stop(m);
+        Expr_Release(mark);
+        done += n;
+    }
+    Report(m, "equal", size, 0, 0, calls);
+
+    Meter_Reset(m);
+    for (long done = 0; done < calls;) {
+        long n = Batch(size + 3 * SUBST_SIZE * size, calls - done);
+        Meter_Start(m);
+        for (long i = 0; i < n; i++) copies[i] = Expr_Substitute(template, sub[0], sub[1], sub[2]);
+        Meter_Stop(m);
+        Expr_Release(mark);
+        done += n;
+    }
+    Report(m, "substitute", size, 0, 0, calls);
+
+    /* Freed nodes go to the free list and are reused by the next clone. */
+    Meter_Reset(m);
+    for (long done = 0; done < calls;) {
+        long n = Batch(size, calls - done);
+        for (long i = 0; i < n; i++) copies[i] = Expr_Clone(e);
+        Meter_Start(m);
+        for (long i = 0; i < n; i++) Expr_Free(copies[i]);
+        Meter_Stop(m);
+        Expr_Release(mark);
+        done += n;
+    }
+    Report(m, "free", size, 0, 0, calls);
+
+    (void)sink;
+    free(copies);
+    Expr_Release(base);
+}
+
+/* One node allocated and freed per call, out of the free list once it is warm. */
+static void BenchAlloc(meter_t *m)
+{
+    long calls = work;
+    Meter_Reset(m);
+    Meter_Start(m);
+    for (long i = 0; i < calls; i++) Expr_Free(Expr_Not(leaves[0]));
+    Meter_Stop(m);
+    Report(m, "alloc_free", 1, 0, 0, calls);
+}
+
+static expr_t **RandomKeys(long n)
+{
+    expr_t **keys = malloc(n * sizeof(expr_t *));
+    if (keys == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    for (long i = 0; i < n; i++) keys[i] = RandomExpr(table_size, leaves, atoms);
+    return keys;
+}
+
+/*
+ * Fills a table of exactly table_buckets buckets to the given occupancy and
+ * looks up clones of its keys (hits, compared node by node like the
+ * formulas the search builds) and fresh formulas (mostly misses).
+ */
+static void BenchTables(meter_t *m, long table_buckets, long percent)
+{
+    expr_mark_t mark = Expr_Mark();
+    long n = table_buckets * percent / 100;
+    expr_t **keys = RandomKeys(n);
+    expr_t **hits = malloc(n * sizeof(expr_t *));
+    if (hits == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    for (long i = 0; i < n; i++) hits[i] = Expr_Clone(keys[i]);
+    expr_t **misses = RandomKeys(n);
+    volatile long found = 0;
+
+    pool_map pool;
+    pool_map_init(&pool);
+    if (!pool_map_reserve(&pool, (size_t)(table_buckets * 0.9))) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    true_expr_t value;
+    memset(&value, 0, sizeof(value));
+
+    Meter_Reset(m);
+    Meter_Start(m);
+    for (long i = 0; i < n; i++) {
+        value.e = keys[i];
+        pool_map_insert(&pool, keys[i], value);
+    }
+    Meter_Stop(m);
+    long size = pool_map_size(&pool);
+    long pool_buckets = pool_map_bucket_count(&pool);
+    Report(m, "pool_insert", table_size, pool_buckets, size, n);
+
+    Meter_Reset(m);
+    Meter_Start(m);
+    for (long i = 0; i < n; i++) found += !pool_map_is_end(pool_map_get(&pool, hits[i]));
+    Meter_Stop(m);
+    Report(m, "pool_hit", table_size, pool_buckets, size, n);
+
+    Meter_Reset(m);
+    Meter_Start(m);
+    for (long i = 0; i < n; i++) found += !pool_map_is_end(pool_map_get(&pool, misses[i]));
+    Meter_Stop(m);
+    Report(m, "pool_miss", table_size, pool_buckets, size, n);
+    pool_map_cleanup(&pool);
+
+    terms_set terms;
+    terms_set_init(&terms);
+    if (!terms_set_reserve(&terms, (size_t)(table_buckets * 0.9))) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    Meter_Reset(m);
+    Meter_Start(m);
+    for (long i = 0; i < n; i++) terms_set_insert(&terms, keys[i]);
+    Meter_Stop(m);
+    size = terms_set_size(&terms);
+    long terms_buckets = terms_set_bucket_count(&terms);
+    Report(m, "terms_insert", table_size, terms_buckets, size, n);
+
+    Meter_Reset(m);
+    Meter_Start(m);
+    for (long i = 0; i < n; i++) found += !terms_set_is_end(terms_set_get(&terms, hits[i]));
+    Meter_Stop(m);
+    Report(m, "terms_hit", table_size, terms_buckets, size, n);
+
+    Meter_Reset(m);
+    Meter_Start(m);
+    for (long i = 0; i < n; i++) found += !terms_set_is_end(terms_set_get(&terms, misses[i]));
+    Meter_Stop(m);
+    Report(m, "terms_miss", table_size, terms_buckets, size, n);
+    terms_set_cleanup(&terms);
+
+    (void)found;
+    free(keys);
+    free(hits);
+    free(misses);
+    Expr_Release(mark);
+}
+
+/* Parses a comma separated list of positive numbers. Returns the count, or -1. */
+static int ParseNumbers(const char *spec, long *list)
+{
+    int n = 0;
+    while (*spec != '\0') {
+        char *end;
+        long value = strtol(spec, &end, 10);
+        if (end == spec || value <= 0 || n == MAX_LIST || (*end != ',' && *end != '\0')) return -1;
+
+        list[n++] = value;
+        spec = *end == ',' ? end + 1 : end;
+    }
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    argv++;
+
+    for (; *argv != NULL; argv++) {
+        int n = 0;
+        if (strncmp(*argv, "+sizes=", 7) == 0) n = size_count = ParseNumbers(*argv + 7, sizes);
+        else if (strncmp(*argv, "+buckets=", 9) == 0) n = bucket_count = ParseNumbers(*argv + 9, buckets);
+        else if (strncmp(*argv, "+occupancy=", 11) == 0) n = occupancy_count = ParseNumbers(*argv + 11, occupancy);
+        else if (strncmp(*argv, "+table-size=", 12) == 0) table_size = atoi(*argv + 12);
+        else if (strncmp(*argv, "+atoms=", 7) == 0) atoms = atoi(*argv + 7);
+        else if (strncmp(*argv, "+work=", 6) == 0) work = atol(*argv + 6);
+        else if (strncmp(*argv, "+seed=", 6) == 0) seed = strtoull(*argv + 6, NULL, 10);
+        else if (strcmp(*argv, "+json") == 0) json = 1;
+        else {
+            printf("unknown option %s\n", *argv);
+            return 1;
+        }
+        if (n < 0) {
+            printf("bad list in %s\n", *argv);
+            return 1;
+        }
+    }
+    if (atoms < 1 || atoms > MAX_ATOMS) {
+        printf("+atoms must be between 1 and %d\n", MAX_ATOMS);
+        return 1;
+    }
+    for (int i = 0; i < occupancy_count; i++) {
+        if (occupancy[i] > 85) {
+            printf("+occupancy is a percentage of at most 85\n");
+            return 1;
+        }
+    }
+    if (seed == 0) seed = 1;
+    if (work < 1) work = 1;
+
+    for (int i = 0; i < atoms; i++) {
+        char name = 'a' + i;
+        leaves[i] = Expr_InternAtom(&name, 1);
+    }
+    variables[0] = Expr_InternAtom("A", 1);
+    variables[1] = Expr_InternAtom("B", 1);
+    variables[2] = Expr_InternAtom("C", 1);
+
+    meter_t meter = { OpenCacheCounter(), 0, { 0, 0 } };
+
+    Expr_SetExitReport(false);
+    Writer_Init(&out, 1);
+    if (!json) Writer_Str(&out, "primitive,size,buckets,occupancy,ops,ns_per_op,cache_misses_per_op\n");
+
+    BenchAlloc(&meter);
+    for (int i = 0; i < size_count; i++) BenchExpr(&meter, sizes[i]);
+    for (int i = 0; i < bucket_count; i++) {
+        for (int j = 0; j < occupancy_count; j++) BenchTables(&meter, buckets[i], occupancy[j]);
+    }
+
+    Writer_Free(&out);
+    return 0;
+}
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/modus-ponens.dir/src/main.c.o"
+  "CMakeFiles/modus-ponens.dir/src/main.c.o.d"
+  "modus-ponens"
+  "modus-ponens.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/modus-ponens.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,37 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/canon.c" "CMakeFiles/modusponens.dir/src/canon.c.o" "gcc" "CMakeFiles/modusponens.dir/src/canon.c.o.d"
+  "/root/repo/src/check.c" "CMakeFiles/modusponens.dir/src/check.c.o" "gcc" "CMakeFiles/modusponens.dir/src/check.c.o.d"
+  "/root/repo/src/expr.c" "CMakeFiles/modusponens.dir/src/expr.c.o" "gcc" "CMakeFiles/modusponens.dir/src/expr.c.o.d"
+  "/root/repo/src/lemmadb.c" "CMakeFiles/modusponens.dir/src/lemmadb.c.o" "gcc" "CMakeFiles/modusponens.dir/src/lemmadb.c.o.d"
+  "/root/repo/src/parser.c" "CMakeFiles/modusponens.dir/src/parser.c.o" "gcc" "CMakeFiles/modusponens.dir/src/parser.c.o.d"
+  "/root/repo/src/pool.c" "CMakeFiles/modusponens.dir/src/pool.c.o" "gcc" "CMakeFiles/modusponens.dir/src/pool.c.o.d"
+  "/root/repo/src/poolimage.c" "CMakeFiles/modusponens.dir/src/poolimage.c.o" "gcc" "CMakeFiles/modusponens.dir/src/poolimage.c.o.d"
+  "/root/repo/src/portfolio.c" "CMakeFiles/modusponens.dir/src/portfolio.c.o" "gcc" "CMakeFiles/modusponens.dir/src/portfolio.c.o.d"
+  "/root/repo/src/proof.c" "CMakeFiles/modusponens.dir/src/proof.c.o" "gcc" "CMakeFiles/modusponens.dir/src/proof.c.o.d"
+  "/root/repo/src/proofbin.c" "CMakeFiles/modusponens.dir/src/proofbin.c.o" "gcc" "CMakeFiles/modusponens.dir/src/proofbin.c.o.d"
+  "/root/repo/src/prover.c" "CMakeFiles/modusponens.dir/src/prover.c.o" "gcc" "CMakeFiles/modusponens.dir/src/prover.c.o.d"
+  "/root/repo/src/rules.c" "CMakeFiles/modusponens.dir/src/rules.c.o" "gcc" "CMakeFiles/modusponens.dir/src/rules.c.o.d"
+  "/root/repo/src/schema.c" "CMakeFiles/modusponens.dir/src/schema.c.o" "gcc" "CMakeFiles/modusponens.dir/src/schema.c.o.d"
+  "/root/repo/src/server.c" "CMakeFiles/modusponens.dir/src/server.c.o" "gcc" "CMakeFiles/modusponens.dir/src/server.c.o.d"
+  "/root/repo/src/source.c" "CMakeFiles/modusponens.dir/src/source.c.o" "gcc" "CMakeFiles/modusponens.dir/src/source.c.o.d"
+  "/root/repo/src/stats.c" "CMakeFiles/modusponens.dir/src/stats.c.o" "gcc" "CMakeFiles/modusponens.dir/src/stats.c.o.d"
+  "/root/repo/src/token.c" "CMakeFiles/modusponens.dir/src/token.c.o" "gcc" "CMakeFiles/modusponens.dir/src/token.c.o.d"
+  "/root/repo/src/trace.c" "CMakeFiles/modusponens.dir/src/trace.c.o" "gcc" "CMakeFiles/modusponens.dir/src/trace.c.o.d"
+  "/root/repo/src/writer.c" "CMakeFiles/modusponens.dir/src/writer.c.o" "gcc" "CMakeFiles/modusponens.dir/src/writer.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
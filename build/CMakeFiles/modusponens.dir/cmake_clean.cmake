@@ -0,0 +1,47 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/modusponens.dir/src/canon.c.o"
+  "CMakeFiles/modusponens.dir/src/canon.c.o.d"
+  "CMakeFiles/modusponens.dir/src/check.c.o"
+  "CMakeFiles/modusponens.dir/src/check.c.o.d"
+  "CMakeFiles/modusponens.dir/src/expr.c.o"
+  "CMakeFiles/modusponens.dir/src/expr.c.o.d"
+  "CMakeFiles/modusponens.dir/src/lemmadb.c.o"
+  "CMakeFiles/modusponens.dir/src/lemmadb.c.o.d"
+  "CMakeFiles/modusponens.dir/src/parser.c.o"
+  "CMakeFiles/modusponens.dir/src/parser.c.o.d"
+  "CMakeFiles/modusponens.dir/src/pool.c.o"
+  "CMakeFiles/modusponens.dir/src/pool.c.o.d"
+  "CMakeFiles/modusponens.dir/src/poolimage.c.o"
+  "CMakeFiles/modusponens.dir/src/poolimage.c.o.d"
+  "CMakeFiles/modusponens.dir/src/portfolio.c.o"
+  "CMakeFiles/modusponens.dir/src/portfolio.c.o.d"
+  "CMakeFiles/modusponens.dir/src/proof.c.o"
+  "CMakeFiles/modusponens.dir/src/proof.c.o.d"
+  "CMakeFiles/modusponens.dir/src/proofbin.c.o"
+  "CMakeFiles/modusponens.dir/src/proofbin.c.o.d"
+  "CMakeFiles/modusponens.dir/src/prover.c.o"
+  "CMakeFiles/modusponens.dir/src/prover.c.o.d"
+  "CMakeFiles/modusponens.dir/src/rules.c.o"
+  "CMakeFiles/modusponens.dir/src/rules.c.o.d"
+  "CMakeFiles/modusponens.dir/src/schema.c.o"
+  "CMakeFiles/modusponens.dir/src/schema.c.o.d"
+  "CMakeFiles/modusponens.dir/src/server.c.o"
+  "CMakeFiles/modusponens.dir/src/server.c.o.d"
+  "CMakeFiles/modusponens.dir/src/source.c.o"
+  "CMakeFiles/modusponens.dir/src/source.c.o.d"
+  "CMakeFiles/modusponens.dir/src/stats.c.o"
+  "CMakeFiles/modusponens.dir/src/stats.c.o.d"
+  "CMakeFiles/modusponens.dir/src/token.c.o"
+  "CMakeFiles/modusponens.dir/src/token.c.o.d"
+  "CMakeFiles/modusponens.dir/src/trace.c.o"
+  "CMakeFiles/modusponens.dir/src/trace.c.o.d"
+  "CMakeFiles/modusponens.dir/src/writer.c.o"
+  "CMakeFiles/modusponens.dir/src/writer.c.o.d"
+  "libmodusponens.a"
+  "libmodusponens.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/modusponens.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
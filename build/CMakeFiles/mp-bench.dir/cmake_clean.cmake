@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/mp-bench.dir/bench/bench.c.o"
+  "CMakeFiles/mp-bench.dir/bench/bench.c.o.d"
+  "mp-bench"
+  "mp-bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/mp-bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
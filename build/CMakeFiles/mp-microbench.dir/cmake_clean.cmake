@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/mp-microbench.dir/bench/microbench.c.o"
+  "CMakeFiles/mp-microbench.dir/bench/microbench.c.o.d"
+  "mp-microbench"
+  "mp-microbench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/mp-microbench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -1,14 +1,200 @@
 #!/bin/bash
+#
+# Performance regression check. First runs a few end-to-end round trips
+# and deep formulas through the CLI and stops if one fails. Then runs the
+# examples and a bounded mp-bench sweep +runs times, and reports for every
+# case its status, median and 90th percentile wall time and peak RSS next
+# to the committed baseline.
+# Exits 1 if a case stopped being proved, disappeared, got slower than its
+# baseline median by more than +threshold percent plus +slack-us (so that
+# millisecond cases do not fail on noise), or its peak RSS grew by more
+# than +rss-threshold percent plus 1 MB.
+#
+#   ./check.sh [+runs=N] [+threshold=PCT] [+rss-threshold=PCT] [+slack-us=US]
+#              [+build=DIR] [+baseline=FILE] [+update-baseline] [prover flags]
+#
+# The baseline is recorded from a Release build, and an unoptimized one
+# reads as a slowdown in every case, so the check configures and builds
+# its own Release tree in build-release/. A tree given with +build must be
+# a Release build too. Prover flags go to modus-ponens for the examples;
+# the baseline is recorded without any. mp-bench runs all its cases in one
+# process, whose peak RSS only grows, so RSS is compared for the examples
+# only. The output of the last run of every example is kept in logs/.
+
+runs=5
+threshold=100
+rss_threshold=25
+slack_us=2000
+build=
+baseline=bench/baseline.txt
+update=0
+flags=()
+
+for arg in "$@"; do
+    case "$arg" in
+    +runs=*)          runs=${arg#*=} ;;
+    +threshold=*)     threshold=${arg#*=} ;;
+    +rss-threshold=*) rss_threshold=${arg#*=} ;;
+    +slack-us=*)      slack_us=${arg#*=} ;;
+    +build=*)         build=${arg#*=} ;;
+    +baseline=*)      baseline=${arg#*=} ;;
+    +update-baseline) update=1 ;;
+    *)                flags+=("$arg") ;;
+    esac
+done
+
+bench_args=(+max-n=4 +max-time=250 +count=2 +strategies=base,neg,self_impl,rules,shortest)
+
+if [ -z "$build" ]; then
+    build=build-release
+    if ! cmake -S . -B "$build" -DCMAKE_BUILD_TYPE=Release > /dev/null ||
+       ! cmake --build "$build" -j"$(nproc)" > /dev/null; then
+        echo "building $build failed"
+        exit 1
+    fi
+fi
+
+if ! grep -qx 'CMAKE_BUILD_TYPE:STRING=Release' "$build/CMakeCache.txt" 2> /dev/null; then
+    echo "$build is not a Release build, configure it with -DCMAKE_BUILD_TYPE=Release"
+    exit 1
+fi
+
+for bin in modus-ponens mp-bench; do
+    if [ ! -x "$build/$bin" ]; then
+        echo "$build/$bin not found, build first"
+        exit 1
+    fi
+done
+
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+failed=0
+Fail() {
+    echo "$1: FAILED"
+    failed=1
+}
+
+# A pool image saved for one goal serves an alpha-equivalent one, whose
+# proof must still use the real axioms.
+"$build/modus-ponens" ./examples/axioms3.txt +save-pool="$tmp/pool.img" < ./examples/a11.txt > /dev/null
+echo '(!p => !p)' | "$build/modus-ponens" ./examples/axioms3.txt +load-pool="$tmp/pool.img" +history > "$tmp/proof.txt"
+"$build/modus-ponens" --check "$tmp/proof.txt" ./examples/axioms3.txt > /dev/null || Fail "pool image round trip"
+
+# Formulas are walked with explicit stacks, so nesting is only limited by
+# memory. A small stack limit makes any recursive walk left over crash here.
+deep=$(printf '%20000s' | tr ' ' '!')p
+( ulimit -s 256; echo "$deep" | "$build/modus-ponens" ./examples/axioms3.txt +lemma-db="$tmp/lemma.db" > /dev/null 2>&1 )
+[ $? -le 1 ] || Fail "deep formula"
+echo '(!r => !r)' | "$build/modus-ponens" ./examples/axioms3.txt +history 2> /dev/null | sed "s/\br\b/$deep/g" > "$tmp/deep.txt"
+( ulimit -s 256; "$build/modus-ponens" --check "$tmp/deep.txt" ./examples/axioms3.txt > /dev/null 2>&1 ) || Fail "deep formula check"
+
+if [ $failed -ne 0 ]; then
+    exit 1
+fi
 
 rm -rf logs
 mkdir logs
 
-for i in $(seq 4 11); do
-    timeout 60 ./build/modus-ponens ./examples/axioms3.txt $@ < "./examples/a$i.txt" 1> "logs/a$i.log" 2>&1
-    retval=$?
-    if [ $retval -ne 0 ]; then
-        echo "a$i.txt: FAILED"
-    else
-        echo "a$i.txt: SUCCESS"
+# One line per case and run: name status wall_us peak_rss_kb, where bench
+# cases have no RSS of their own and record 0.
+samples="$tmp/samples"
+: > "$samples"
+
+for run in $(seq "$runs"); do
+    for input in ./examples/1.txt $(seq -f "./examples/a%g.txt" 4 11); do
+        name=$(basename "$input" .txt)
+        start=$(date +%s%N)
+        timeout 60 "$build/modus-ponens" ./examples/axioms3.txt +stats=json "${flags[@]}" < "$input" \
+            1> "logs/$name.log" 2> "$tmp/stats"
+        retval=$?
+        end=$(date +%s%N)
+
+        case $retval in
+        0)   status=proved ;;
+        1)   status=not_found ;;
+        124) status=timeout ;;
+        *)   status=failed ;;
+        esac
+        rss=$(grep -o '"peak_rss_kb":[0-9]*' "$tmp/stats" | cut -d: -f2)
+        echo "$name $status $(( (end - start) / 1000 )) ${rss:-0}" >> "$samples"
+    done
+
+    if ! "$build/mp-bench" ./examples/axioms3.txt "${bench_args[@]}" > "$tmp/bench.csv"; then
+        echo "mp-bench: FAILED"
+        exit 1
     fi
-done
\ No newline at end of file
+    awk -F, 'NR > 1 { print $1 "-" $2 "-" $3 "-" $4, $5, $6, 0 }' "$tmp/bench.csv" >> "$samples"
+    echo "run $run/$runs done" >&2
+done
+
+# Per case: status (proved only if every run proved), median, p90, peak RSS.
+results="$tmp/results"
+sort -k1,1 -k3,3n "$samples" | awk '
+function flush(    p90) {
+    p90 = int(0.9 * n)
+    if (p90 < 0.9 * n) p90++
+    print name, status, t[int((n + 1) / 2)], t[p90], rss
+}
+$1 != name {
+    if (name != "") flush()
+    name = $1; status = $2; n = 0; rss = 0
+}
+{
+    t[++n] = $3
+    if ($4 > rss) rss = $4
+    if (status == "proved" && $2 != "proved") status = $2
+}
+END { if (name != "") flush() }
+' > "$results"
+
+if [ $update -eq 1 ]; then
+    {
+        echo "# check.sh baseline: $runs runs, recorded with ./check.sh +update-baseline"
+        echo "# case status median_us p90_us peak_rss_kb"
+        cat "$results"
+    } > "$baseline"
+    echo "baseline written to $baseline ($(wc -l < "$results") cases)"
+    exit 0
+fi
+
+if [ ! -f "$baseline" ]; then
+    echo "$baseline not found, record one with +update-baseline"
+    exit 1
+fi
+
+awk -v threshold="$threshold" -v rss_threshold="$rss_threshold" -v slack="$slack_us" '
+BEGIN {
+    printf "%-28s %-10s %10s %10s %10s %7s %9s  %s\n", "case", "status", "median ms", "p90 ms",
+        "base ms", "ratio", "rss kB", "verdict"
+}
+NR == FNR {
+    if ($1 !~ /^#/) { base_status[$1] = $2; base_median[$1] = $3; base_rss[$1] = $5 }
+    next
+}
+{
+    seen[$1] = 1
+    verdict = "ok"
+    if (!($1 in base_median)) verdict = "new"
+    else if (base_status[$1] == "proved" && $2 != "proved") verdict = "REGRESSED: status"
+    else if ($3 > base_median[$1] * (1 + threshold / 100) + slack) verdict = "REGRESSED: time"
+    else if ($5 > 0 && $5 > base_rss[$1] * (1 + rss_threshold / 100) + 1024) verdict = "REGRESSED: rss"
+    if (verdict ~ /^REGRESSED/) regressed++
+
+    ratio = base_median[$1] > 0 ? sprintf("%.2fx", $3 / base_median[$1]) : "-"
+    printf "%-28s %-10s %10.1f %10.1f %10.1f %7s %9s  %s\n", $1, $2, $3 / 1000, $4 / 1000,
+        base_median[$1] / 1000, ratio, ($5 > 0 ? $5 : "-"), verdict
+    cases++
+}
+END {
+    for (name in base_median) {
+        if (!(name in seen)) {
+            printf "%-28s %-10s %10s %10s %10.1f %7s %9s  %s\n", name, "-", "-", "-",
+                base_median[name] / 1000, "-", "-", "REGRESSED: missing"
+            regressed++
+        }
+    }
+    printf "%d cases, %d regressed\n", cases, regressed
+    exit regressed > 0
+}
+' "$baseline" "$results"
@@ -0,0 +1,228 @@
+#include "canon.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NAME rename_memo
+#define KEY_TY uint64_t
+#define VAL_TY expr_t*
+#include "verstable.h"
+
+void Canon_Init(renaming_t *r)
+{
+    r->from = NULL;
+    r->to = NULL;
+    r->count = 0;
+    r->capacity = 0;
+}
+
+void Canon_Free(renaming_t *r)
+{
+    free(r->from);
+    free(r->to);
+    Canon_Init(r);
+}
+
+void Canon_Add(renaming_t *r, const char *from, const char *to)
+{
+    if (r->count == r->capacity) {
+        r->capacity = r->capacity ? r->capacity * 2 : 16;
+        r->from = realloc(r->from, r->capacity * sizeof(*r->from));
+        r->to = realloc(r->to, r->capacity * sizeof(*r->to));
+        if (r->from == NULL || r->to == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+
+    strncpy(r->from[r->count], from, sizeof(r->from[0]) - 1);
+    r->from[r->count][sizeof(r->from[0]) - 1] = '\0';
+    strncpy(r->to[r->count], to, sizeof(r->to[0]) - 1);
+    r->to[r->count][sizeof(r->to[0]) - 1] = '\0';
+    r->count++;
+}
+
+/* Formulas have a handful of atoms, so a linear scan beats hashing here. */
+const char *Canon_Lookup(renaming_t *r, const char *name)
+{
+    for (int i = 0; i < r->count; i++) {
+        if (strcmp(r->from[i], name) == 0) return r->to[i];
+    }
+    return NULL;
+}
+
+/* 0 -> a, 25 -> z, 26 -> aa, ... */
+static void CanonicalName(int idx, char *name)
+{
+    char tmp[16];
+    int len = 0;
+    do {
+        tmp[len++] = 'a' + idx % 26;
+        idx = idx / 26 - 1;
+    } while (idx >= 0 && len < 15);
+
+    for (int i = 0; i < len; i++) name[i] = tmp[len - 1 - i];
+    name[len] = '\0';
+}
+
+/* The inverse of CanonicalName: a -> 0, aa -> 26, ...; -1 if name is not canonical. */
+int Canon_Index(const char *name, int len)
+{
+    if (len <= 0 || len > 6) return -1;
+
+    int value = 0;
+    for (int i = 0; i < len; i++) {
+        if (name[i] < 'a' || name[i] > 'z') return -1;
+        value = value * 26 + (name[i] - 'a' + 1);
+    }
+    return value - 1;
+}
+
+/* Extends r with the atoms of e it does not map yet, left to right. */
+void Canon_Build(renaming_t *r, expr_t *e)
+{
+    expr_t *local[64];
+    expr_t **stack = local;
+    int sp = 0, cap = 64;
+    stack[sp++] = e;
+
+    while (sp > 0) {
+        e = stack[--sp];
+        if (sp + 2 > cap) stack = Expr_GrowStack(stack, local, &cap, sizeof(expr_t *));
+
+        switch (e->type) {
+        case EXPR_IMPLIES:
+            stack[sp++] = e->implies.b;
+            stack[sp++] = e->implies.a;
+            break;
+        case EXPR_NOT:
+            stack[sp++] = e->not.a;
+            break;
+        case EXPR_ATOM:
+            if (Canon_Lookup(r, e->atom.name) == NULL) {
+                char name[16];
+                CanonicalName(r->count, name);
+                Canon_Add(r, e->atom.name, name);
+            }
+            break;
+        }
+    }
+
+    if (stack != local) free(stack);
+}
+
+void Canon_Invert(renaming_t *r, renaming_t *inverse)
+{
+    Canon_Init(inverse);
+    for (int i = 0; i < r->count; i++) {
+        Canon_Add(inverse, r->to[i], r->from[i]);
+    }
+}
+
+typedef struct {
+    expr_t *e;
+    int state;
+} rename_frame_t;
+
+/*
+ * Copies e with its atoms renamed, children before parents. With a memo,
+ * nodes already renamed are reused by address, so shared subformulas stay
+ * shared in the copy.
+ */
+static expr_t *Rename(rename_memo *memo, renaming_t *r, expr_t *e)
+{
+    if (e == NULL) return NULL;
+
+    rename_frame_t frames_local[64];
+    rename_frame_t *frames = frames_local;
+    int sp = 0, cap = 64;
+
+    expr_t *values_local[64];
+    expr_t **values = values_local;
+    int vp = 0, vcap = 64;
+
+    frames[sp++] = (rename_frame_t){ e, 0 };
+    while (sp > 0) {
+        rename_frame_t *f = &frames[sp - 1];
+        e = f->e;
+
+        if (vp + 1 > vcap) values = Expr_GrowStack(values, values_local, &vcap, sizeof(expr_t *));
+
+        expr_t *res;
+        if (f->state == 1) {
+            sp--;
+            if (e->type == EXPR_IMPLIES) {
+                expr_t *b = values[--vp];
+                expr_t *a = values[--vp];
+                res = Expr_Implies(a, b);
+            }
+            else {
+                res = Expr_Not(values[--vp]);
+            }
+        }
+        else {
+            if (memo != NULL) {
+                rename_memo_itr iter = rename_memo_get(memo, (uintptr_t)e);
+                if (!rename_memo_is_end(iter)) {
+                    values[vp++] = iter.data->val;
+                    sp--;
+                    continue;
+                }
+            }
+
+            if (e->type != EXPR_ATOM) {
+                f->state = 1;
+                if (sp + 2 > cap) frames = Expr_GrowStack(frames, frames_local, &cap, sizeof(rename_frame_t));
+                if (e->type == EXPR_IMPLIES) {
+                    frames[sp++] = (rename_frame_t){ e->implies.b, 0 };
+                    frames[sp++] = (rename_frame_t){ e->implies.a, 0 };
+                }
+                else {
+                    frames[sp++] = (rename_frame_t){ e->not.a, 0 };
+                }
+                continue;
+            }
+
+            sp--;
+            const char *name = Canon_Lookup(r, e->atom.name);
+            res = Expr_Atom((char *)(name != NULL ? name : e->atom.name));
+        }
+
+        if (memo != NULL) rename_memo_insert(memo, (uintptr_t)e, res);
+        values[vp++] = res;
+    }
+
+    expr_t *res = values[0];
+    if (frames != frames_local) free(frames);
+    if (values != values_local) free(values);
+    return res;
+}
+
+/* Returns a fresh copy of e with its atoms renamed. */
+expr_t *Canon_Apply(renaming_t *r, expr_t *e)
+{
+    return Rename(NULL, r, e);
+}
+
+/*
+ * Renames the formulas and bindings of every step in place. Steps share
+ * subformulas, so renamed nodes are memoized by address and the result
+ * shares them the same way. Axiom schemas are not touched.
+ */
+void Canon_ApplyProof(renaming_t *r, proof_t *proof)
+{
+    rename_memo memo;
+    rename_memo_init(&memo);
+
+    for (int i = 0; i < proof->count; i++) {
+        proof_step_t *step = &proof->steps[i];
+        step->e = Rename(&memo, r, step->e);
+        if (step->type == INFERENCE_AXIOM) {
+            step->axiom.A = Rename(&memo, r, step->axiom.A);
+            step->axiom.B = Rename(&memo, r, step->axiom.B);
+            step->axiom.C = Rename(&memo, r, step->axiom.C);
+        }
+    }
+
+    rename_memo_cleanup(&memo);
+}
@@ -0,0 +1,33 @@
+#ifndef CANON_H
+#define CANON_H
+
+#include "proof.h"
+
+/*
+ * Renaming of atoms. Canon_Build numbers the atoms of a formula in order of
+ * first occurrence and maps them to a, b, ..., z, aa, ab, ..., so formulas
+ * that differ only in atom names get the same canonical form. Atoms not in
+ * the renaming are left alone, which keeps the axiom schema variables
+ * (A, B, C) intact. Renaming atoms maps proofs to proofs, so a proof of a
+ * canonical formula becomes a proof of the original under the inverse.
+ */
+typedef struct {
+    char (*from)[16];
+    char (*to)[16];
+    int count;
+    int capacity;
+} renaming_t;
+
+void Canon_Init(renaming_t *r);
+void Canon_Free(renaming_t *r);
+
+void Canon_Add(renaming_t *r, const char *from, const char *to);
+void Canon_Build(renaming_t *r, expr_t *e);
+void Canon_Invert(renaming_t *r, renaming_t *inverse);
+const char *Canon_Lookup(renaming_t *r, const char *name);
+int Canon_Index(const char *name, int len);
+
+expr_t *Canon_Apply(renaming_t *r, expr_t *e);
+void    Canon_ApplyProof(renaming_t *r, proof_t *proof);
+
+#endif
@@ -0,0 +1,444 @@
+#include "check.h"
+#include "parser.h"
+#include "proofbin.h"
+#include "writer.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NAME intern_set
+#define KEY_TY expr_t*
+#define HASH_FN Expr_Hash
+#define CMPR_FN Expr_Equal
+#include "verstable.h"
+
+#define NAME number_map
+#define KEY_TY long
+#define VAL_TY int
+#include "verstable.h"
+
+#define MIN_STEPS_PER_THREAD 256
+
+typedef struct {
+    proof_t *proof;
+    intern_set interned;
+    number_map numbers;
+    FILE *f;
+    char *line;
+    size_t line_cap;
+} text_loader_t;
+
+typedef struct {
+    expr_t **slot;
+    int state;
+} intern_frame_t;
+
+/* Hash-conses e bottom-up, so equal subformulas become one expression;
+ * the duplicate nodes are freed as they are replaced. */
+static expr_t *Intern(intern_set *set, expr_t *e)
+{
+    intern_frame_t local[64];
+    intern_frame_t *stack = local;
+    int sp = 0, cap = 64;
+    stack[sp++] = (intern_frame_t){ &e, 0 };
+
+    while (sp > 0) {
+        intern_frame_t *f = &stack[sp - 1];
+        expr_t *node = *f->slot;
+
+        if (f->state == 0 && node->type != EXPR_ATOM) {
+            f->state = 1;
+            if (sp + 2 > cap) stack = Expr_GrowStack(stack, local, &cap, sizeof(intern_frame_t));
+            if (node->type == EXPR_IMPLIES) {
+                stack[sp++] = (intern_frame_t){ &node->implies.b, 0 };
+                stack[sp++] = (intern_frame_t){ &node->implies.a, 0 };
+            }
+            else {
+                stack[sp++] = (intern_frame_t){ &node->not.a, 0 };
+            }
+            continue;
+        }
+
+        sp--;
+        intern_set_itr iter = intern_set_get(set, node);
+        if (!intern_set_is_end(iter)) {
+            *f->slot = iter.data->key;
+            if (iter.data->key != node) Expr_FreeItself(node);
+        }
+        else {
+            intern_set_insert(set, node);
+        }
+    }
+
+    if (stack != local) free(stack);
+    return e;
+}
+
+/* NULL if s is not a well-formed formula; the parser itself would trap. */
+static expr_t *ReadFormula(text_loader_t *l, const char *s)
+{
+    const char *end = s + strlen(s);
+    if (Parser_Check(s, end) != NULL) return NULL;
+
+    parser_t parser;
+    Parser_InitRange(&parser, s, end);
+    return Intern(&l->interned, Parser_ReadExpr(&parser));
+}
+
+static bool NextLine(text_loader_t *l)
+{
+    return getline(&l->line, &l->line_cap, l->f) >= 0;
+}
+
+static bool ReadBinding(text_loader_t *l, char var, expr_t **binding)
+{
+    char prefix[] = "       X = ";
+    prefix[7] = var;
+
+    if (!NextLine(l) || strncmp(l->line, prefix, sizeof(prefix) - 1) != 0) {
+        return false;
+    }
+    *binding = ReadFormula(l, l->line + sizeof(prefix) - 1);
+    return *binding != NULL;
+}
+
+static int FindNumber(text_loader_t *l, long number)
+{
+    number_map_itr iter = number_map_get(&l->numbers, number);
+    return number_map_is_end(iter) ? -1 : iter.data->val;
+}
+
+static bool AddStep(text_loader_t *l, long number, proof_step_t *step)
+{
+    if (FindNumber(l, number) >= 0) {
+        return false;
+    }
+    number_map_insert(&l->numbers, number, Proof_Push(l->proof, step));
+    return true;
+}
+
+static bool ReadAxiomStep(text_loader_t *l)
+{
+    proof_step_t step;
+    step.type = INFERENCE_AXIOM;
+    step.axiom.axiom = ReadFormula(l, l->line + strlen("   Axiom = "));
+    if (step.axiom.axiom == NULL) return false;
+
+    if (!ReadBinding(l, 'A', &step.axiom.A)) return false;
+    if (!ReadBinding(l, 'B', &step.axiom.B)) return false;
+    if (!ReadBinding(l, 'C', &step.axiom.C)) return false;
+
+    if (!NextLine(l)) return false;
+    char *rest;
+    long number = strtol(l->line, &rest, 10);
+    if (rest == l->line) return false;
+    step.e = ReadFormula(l, rest);
+
+    return step.e != NULL && AddStep(l, number, &step);
+}
+
+/* Reads a premise reference "<number> <formula>" and checks it against the step it names. */
+static int ReadPremise(text_loader_t *l, const char *s)
+{
+    char *rest;
+    long number = strtol(s, &rest, 10);
+    int idx = FindNumber(l, number);
+    if (rest == s || idx < 0) return -1;
+
+    expr_t *e = ReadFormula(l, rest);
+    return e != NULL && Expr_Equal(e, l->proof->steps[idx].e) ? idx : -1;
+}
+
+static bool ReadModusPonensStep(text_loader_t *l)
+{
+    proof_step_t step;
+    step.type = INFERENCE_MODUS_PONENS;
+
+    step.modus_ponens.A_impl_B = ReadPremise(l, l->line);
+    if (step.modus_ponens.A_impl_B < 0 || !NextLine(l)) return false;
+    step.modus_ponens.A = ReadPremise(l, l->line);
+    if (step.modus_ponens.A < 0 || !NextLine(l)) return false;
+
+    char *rest;
+    long number = strtol(l->line, &rest, 10);
+    char *conclusion = strstr(rest, "|- ");
+    if (rest == l->line || conclusion == NULL) return false;
+    step.e = ReadFormula(l, conclusion + 3);
+
+    return step.e != NULL && AddStep(l, number, &step);
+}
+
+/*
+ * Reads the text printed by Proof_Print. Lines outside of proof steps
+ * (TERMS, GOAL FOUND, allocation counters) are skipped. Step numbers only
+ * need to be unique, so sparse numbering from older output is accepted too.
+ */
+static int LoadTextProof(const char *path, proof_t *proof)
+{
+    text_loader_t l;
+    l.proof = proof;
+    l.f = fopen(path, "r");
+    l.line = NULL;
+    l.line_cap = 0;
+    if (l.f == NULL) return -1;
+
+    intern_set_init(&l.interned);
+    number_map_init(&l.numbers);
+
+    int res = 0;
+    while (res == 0 && NextLine(&l)) {
+        if (strncmp(l.line, "   Axiom = ", 11) == 0) {
+            if (!ReadAxiomStep(&l)) res = -2;
+            continue;
+        }
+
+        char *rest;
+        long number = strtol(l.line, &rest, 10);
+        if (rest == l.line || *rest != ' ') continue;
+
+        if (strncmp(rest, " DEDUCTED ", 10) == 0) {
+            proof_step_t step;
+            step.type = INFERENCE_DEDUCTION;
+            step.e = ReadFormula(&l, rest + 10);
+            if (step.e == NULL || !AddStep(&l, number, &step)) res = -2;
+        }
+        else if (!ReadModusPonensStep(&l)) res = -2;
+    }
+
+    free(l.line);
+    fclose(l.f);
+    intern_set_cleanup(&l.interned);
+    number_map_cleanup(&l.numbers);
+    return res;
+}
+
+/* Returns -1 if the proof cannot be read and -2 if it is malformed; proof then holds the steps before the bad one. */
+int Check_LoadProof(const char *path, proof_t *proof)
+{
+    if (!ProofBin_Probe(path)) {
+        return LoadTextProof(path, proof);
+    }
+
+    proofbin_map_t map;
+    if (ProofBin_Map(path, &map) != 0) {
+        return -1;
+    }
+    int res = ProofBin_Load(&map, proof) != 0 ? -2 : 0;
+    ProofBin_Unmap(&map);
+    return res;
+}
+
+typedef struct {
+    expr_t *schema, *e;
+} instance_item_t;
+
+/* Same semantics as Expr_Substitute(schema, A, B, C) == e, without building the instance. */
+static bool IsInstance(expr_t *schema, expr_t *e, axiom_inst_t *ax)
+{
+    instance_item_t local[64];
+    instance_item_t *stack = local;
+    int sp = 0, cap = 64;
+    stack[sp++] = (instance_item_t){ schema, e };
+
+    bool match = true;
+    while (sp > 0 && match) {
+        instance_item_t item = stack[--sp];
+        schema = item.schema;
+        e = item.e;
+        if (sp + 2 > cap) stack = Expr_GrowStack(stack, local, &cap, sizeof(instance_item_t));
+
+        switch (schema->type) {
+        case EXPR_ATOM:
+            if (strcmp(schema->atom.name, "A") == 0 && ax->A != NULL) match = Expr_Equal(e, ax->A);
+            else if (strcmp(schema->atom.name, "B") == 0 && ax->B != NULL) match = Expr_Equal(e, ax->B);
+            else if (strcmp(schema->atom.name, "C") == 0 && ax->C != NULL) match = Expr_Equal(e, ax->C);
+            else match = false;
+            break;
+
+        case EXPR_IMPLIES:
+            match = e->type == EXPR_IMPLIES;
+            if (!match) break;
+            stack[sp++] = (instance_item_t){ schema->implies.b, e->implies.b };
+            stack[sp++] = (instance_item_t){ schema->implies.a, e->implies.a };
+            break;
+
+        case EXPR_NOT:
+            match = e->type == EXPR_NOT;
+            if (!match) break;
+            stack[sp++] = (instance_item_t){ schema->not.a, e->not.a };
+            break;
+        }
+    }
+
+    if (stack != local) free(stack);
+    return match;
+}
+
+static const char *CheckStep(proof_t *proof, int i, expr_t **axioms, int axiom_count)
+{
+    proof_step_t *step = &proof->steps[i];
+
+    switch (step->type) {
+    case INFERENCE_AXIOM: {
+        int j = 0;
+        while (j < axiom_count && !Expr_Equal(axioms[j], step->axiom.axiom)) j++;
+        if (j == axiom_count) return "unknown axiom";
+        if (!IsInstance(step->axiom.axiom, step->e, &step->axiom)) return "not an instance of its axiom";
+        return NULL;
+    }
+
+    case INFERENCE_MODUS_PONENS: {
+        int major = step->modus_ponens.A_impl_B;
+        int minor = step->modus_ponens.A;
+        if (major < 0 || major >= i || minor < 0 || minor >= i) return "premise does not precede the step";
+
+        expr_t *A_impl_B = proof->steps[major].e;
+        if (A_impl_B->type != EXPR_IMPLIES ||
+            !Expr_Equal(A_impl_B->implies.a, proof->steps[minor].e) ||
+            !Expr_Equal(A_impl_B->implies.b, step->e)) return "not a modus ponens conclusion";
+        return NULL;
+    }
+
+    case INFERENCE_DEDUCTION:
+        return "deduction steps are not checkable";
+
+    case INFERENCE_RULE:
+        return "rule steps are not checkable";
+    }
+
+    return "unknown step type";
+}
+
+typedef struct {
+    proof_t *proof;
+    expr_t **axioms;
+    int axiom_count;
+    int begin, end;
+    check_result_t res;
+} check_job_t;
+
+static void *CheckRange(void *arg)
+{
+    check_job_t *job = arg;
+    for (int i = job->begin; i < job->end; i++) {
+        const char *reason = CheckStep(job->proof, i, job->axioms, job->axiom_count);
+        if (reason != NULL) {
+            job->res.failed_at = i;
+            job->res.reason = reason;
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void HashStep(proof_step_t *step)
+{
+    Expr_Hash(step->e);
+    if (step->type == INFERENCE_AXIOM) {
+        Expr_Hash(step->axiom.axiom);
+        if (step->axiom.A) Expr_Hash(step->axiom.A);
+        if (step->axiom.B) Expr_Hash(step->axiom.B);
+        if (step->axiom.C) Expr_Hash(step->axiom.C);
+    }
+}
+
+/*
+ * Every step only reads earlier formulas, so the steps are split into
+ * contiguous ranges checked concurrently. Hashes are filled in up front:
+ * after that Expr_Equal does not write to the expressions.
+ */
+void Check_Proof(proof_t *proof, expr_t **axioms, int axiom_count, int threads, check_result_t *res)
+{
+    res->failed_at = -1;
+    res->reason = NULL;
+
+    for (int i = 0; i < proof->count; i++) HashStep(&proof->steps[i]);
+    for (int i = 0; i < axiom_count; i++) Expr_Hash(axioms[i]);
+
+    int max_threads = proof->count / MIN_STEPS_PER_THREAD + 1;
+    if (threads > max_threads) threads = max_threads;
+    if (threads < 1) threads = 1;
+
+    check_job_t *jobs = malloc(threads * sizeof(check_job_t));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    bool *started = calloc(threads, sizeof(bool));
+
+    int chunk = (proof->count + threads - 1) / threads;
+    for (int t = 0; t < threads; t++) {
+        check_job_t *job = &jobs[t];
+        job->proof = proof;
+        job->axioms = axioms;
+        job->axiom_count = axiom_count;
+        job->begin = t * chunk < proof->count ? t * chunk : proof->count;
+        job->end = job->begin + chunk < proof->count ? job->begin + chunk : proof->count;
+        job->res.failed_at = -1;
+        job->res.reason = NULL;
+
+        if (t > 0) started[t] = pthread_create(&tids[t], NULL, CheckRange, job) == 0;
+    }
+
+    CheckRange(&jobs[0]);
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) pthread_join(tids[t], NULL);
+        else CheckRange(&jobs[t]);
+    }
+
+    for (int t = 0; t < threads; t++) {
+        if (jobs[t].res.failed_at >= 0) {
+            *res = jobs[t].res;
+            break;
+        }
+    }
+
+    free(jobs);
+    free(tids);
+    free(started);
+}
+
+int Check_Run(const char *path, expr_t **axioms, int axiom_count)
+{
+    proof_t proof;
+    Proof_Init(&proof);
+
+    int loaded = Check_LoadProof(path, &proof);
+    if (loaded == -1) {
+        fprintf(stderr, "failed to read proof %s\n", path);
+        Proof_Free(&proof);
+        return 1;
+    }
+
+    check_result_t res;
+    if (loaded != 0) {
+        res.failed_at = proof.count;
+        res.reason = "malformed step";
+    }
+    else if (proof.count == 0) {
+        res.failed_at = 0;
+        res.reason = "empty proof";
+    }
+    else {
+        Check_Proof(&proof, axioms, axiom_count, sysconf(_SC_NPROCESSORS_ONLN), &res);
+    }
+
+    Writer_Init(&out, 1);
+    if (res.failed_at < 0) {
+        Writer_Str(&out, "PROOF OK: ");
+        Writer_Int(&out, proof.count, 0);
+        Writer_Str(&out, " steps, ");
+        Writer_Expr(&out, proof.steps[proof.count - 1].e);
+        Writer_Char(&out, '\n');
+    }
+    else {
+        Writer_Str(&out, "PROOF FAILED at step ");
+        Writer_Int(&out, res.failed_at + 1, 0);
+        Writer_Str(&out, ": ");
+        Writer_Str(&out, res.reason);
+        Writer_Char(&out, '\n');
+    }
+    Writer_Free(&out);
+
+    Proof_Free(&proof);
+    return res.failed_at >= 0;
+}
@@ -0,0 +1,15 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include "proof.h"
+
+typedef struct {
+    int failed_at;
+    const char *reason;
+} check_result_t;
+
+int  Check_LoadProof(const char *path, proof_t *proof);
+void Check_Proof(proof_t *proof, expr_t **axioms, int axiom_count, int threads, check_result_t *res);
+int  Check_Run(const char *path, expr_t **axioms, int axiom_count);
+
+#endif
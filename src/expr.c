@@ -1,129 +1,293 @@
 #include "expr.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 
-#define ARENA_SIZE 10000000
-static expr_t arena[ARENA_SIZE];
-static int arena_idx = 0;
 
-static int frees[ARENA_SIZE];
-static int free_count = 0;
+/*
+ * Every thread allocates from its own arena. The arena is reserved on the
+ * first allocation and the kernel commits its pages as they are touched,
+ * so fresh slots are zero and an idle thread costs nothing. Expressions
+ * outside the calling thread's arena (interned atoms, and the axioms of
+ * the main thread as seen by a worker) are shared and never freed by it.
+ */
+static _Thread_local expr_arena_t arena;
 
-static int atexit_added = 0;
+static atomic_int retired_alloc_cnt;
+static atomic_int retired_free_cnt;
 
-static int alloc_cnt = 0;
-static int free_cnt = 0;
+static pthread_once_t check_once = PTHREAD_ONCE_INIT;
+
+static atomic_bool exit_report = true;
 
 static void Expr_Check()
 {
-    printf("Allocated: %d exprs\n", alloc_cnt);
-    printf("Freed: %d exprs\n", free_cnt);
+    if (!atomic_load(&exit_report)) return;
+    printf("Allocated: %d exprs\n", arena.alloc_cnt + atomic_load(&retired_alloc_cnt));
+    printf("Freed: %d exprs\n", arena.free_cnt + atomic_load(&retired_free_cnt));
 }
 
-static expr_t *AllocExpr()
+static void Expr_AddCheck()
+{
+    atexit(Expr_Check);
+}
+
+/* Turns the allocation counts printed at exit on or off. */
+void Expr_SetExitReport(bool enabled)
 {
-    if (!atexit_added) {
-        atexit_added = 1;
-        atexit(Expr_Check);
+    atomic_store(&exit_report, enabled);
+}
+
+static void *Reserve(size_t size)
+{
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
     }
+    return base;
+}
+
+static void ArenaInit()
+{
+    pthread_once(&check_once, Expr_AddCheck);
+    arena.exprs = Reserve(ARENA_SIZE * sizeof(expr_t));
+    arena.frees = Reserve(ARENA_SIZE * sizeof(int));
+}
+
+/*
+ * Exchanges the calling thread's arena with a, so a prover context can
+ * bring its own arena along while it runs. A zeroed arena is empty.
+ */
+void Expr_SwapArena(expr_arena_t *a)
+{
+    expr_arena_t tmp = arena;
+    arena = *a;
+    *a = tmp;
+}
+
+/* Unmaps the calling thread's arena. Its expressions must no longer be referenced. */
+void Expr_FreeArena(void)
+{
+    if (arena.exprs == NULL) return;
 
-    if (arena_idx >= ARENA_SIZE) {
+    atomic_fetch_add(&retired_alloc_cnt, arena.alloc_cnt);
+    atomic_fetch_add(&retired_free_cnt, arena.free_cnt);
+    munmap(arena.exprs, ARENA_SIZE * sizeof(expr_t));
+    munmap(arena.frees, ARENA_SIZE * sizeof(int));
+    memset(&arena, 0, sizeof(arena));
+}
+
+static expr_t *AllocExpr()
+{
+    if (arena.exprs == NULL) ArenaInit();
+
+    if (arena.idx >= ARENA_SIZE) {
         fprintf(stderr, "Expr limit exceeded\n");
         exit(1);
     }
 
-    alloc_cnt++;
-    if (free_count > 0) {
-        expr_t *expr = arena + frees[--free_count];
+    arena.alloc_cnt++;
+    if (arena.free_count > 0) {
+        expr_t *expr = arena.exprs + arena.frees[--arena.free_count];
         memset(expr, 0, sizeof(expr_t));
         return expr;
     }
 
-    return arena + arena_idx++;
+    return arena.exprs + arena.idx++;
 }
 
-void Expr_FreeItself(expr_t *expr)
+/* Contiguous block of n expressions, used to load whole expression tables at once. */
+expr_t *Expr_AllocArray(int n)
 {
-    free_cnt++;
-    int idx = expr - arena;
-    frees[free_count++] = idx;
+    if (arena.exprs == NULL) ArenaInit();
+
+    if (arena.idx + n > ARENA_SIZE) {
+        fprintf(stderr, "Expr limit exceeded\n");
+        exit(1);
+    }
+
+    arena.alloc_cnt += n;
+    expr_t *exprs = arena.exprs + arena.idx;
+    arena.idx += n;
+    return exprs;
 }
 
-void Expr_Free(expr_t *expr)
+/*
+ * Everything the calling thread allocated after a mark is dropped at once
+ * by releasing it; batch mode marks after loading the axioms and releases
+ * after each goal. Free slots below the mark stay in the free list.
+ */
+expr_mark_t Expr_Mark(void)
 {
-    switch (expr->type) {
-    case EXPR_IMPLIES:
-        Expr_Free(expr->implies.a);
-        Expr_Free(expr->implies.b);
-        break;
-    case EXPR_NOT:
-        Expr_Free(expr->not.a);
-        break;
-    default:
-        break;
-    }
+    return (expr_mark_t){ arena.idx };
+}
 
-    Expr_FreeItself(expr);
+/* Slots used in the calling thread's arena, free ones below the top included. */
+int Expr_ArenaUsed(void)
+{
+    return arena.idx;
 }
 
-int Expr_Print(expr_t *expr)
+void Expr_Release(expr_mark_t mark)
 {
-    int a, b;
-    switch (expr->type) {
-    case EXPR_IMPLIES:
-        printf("(");
-        a = Expr_Print(expr->implies.a);
-        printf(" => ");
-        b = Expr_Print(expr->implies.b);
-        printf(")");
-        return 6 + a + b;
+    if (arena.idx <= mark.arena_idx) return;
 
-    case EXPR_NOT:
-        printf("!");
-        return 1 + Expr_Print(expr->not.a);
+    memset(arena.exprs + mark.arena_idx, 0, (arena.idx - mark.arena_idx) * sizeof(expr_t));
+    arena.idx = mark.arena_idx;
 
-    case EXPR_ATOM:
-        printf("%s", expr->atom.name);
-        return strlen(expr->atom.name);
+    int kept = 0;
+    for (int i = 0; i < arena.free_count; i++) {
+        if (arena.frees[i] < mark.arena_idx) arena.frees[kept++] = arena.frees[i];
+    }
+    arena.free_count = kept;
+}
+
+static bool IsInterned(expr_t *e);
+
+void Expr_FreeItself(expr_t *expr)
+{
+    if (IsInterned(expr)) {
+        return;
     }
 
-    return 0;
+    arena.free_cnt++;
+    int idx = expr - arena.exprs;
+    arena.frees[arena.free_count++] = idx;
 }
 
-int Expr_Equal(expr_t *a, expr_t *b)
+#define STACK_LOCAL 64
+
+void *Expr_GrowStack(void *stack, void *local, int *cap, size_t elem_size)
 {
-    if (Expr_Hash(a) != Expr_Hash(b)) {
-        return 0;
+    void *grown = malloc(2 * (size_t)*cap * elem_size);
+    if (grown == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
     }
 
-    if (a->type != b->type) {
-        return 0;
+    memcpy(grown, stack, (size_t)*cap * elem_size);
+    if (stack != local) free(stack);
+    *cap *= 2;
+    return grown;
+}
+
+void Expr_Free(expr_t *expr)
+{
+    expr_t *local[STACK_LOCAL];
+    expr_t **stack = local;
+    int sp = 0, cap = STACK_LOCAL;
+    stack[sp++] = expr;
+
+    while (sp > 0) {
+        expr_t *e = stack[--sp];
+        if (sp + 2 > cap) stack = Expr_GrowStack(stack, local, &cap, sizeof(expr_t *));
+
+        switch (e->type) {
+        case EXPR_IMPLIES:
+            stack[sp++] = e->implies.b;
+            stack[sp++] = e->implies.a;
+            break;
+        case EXPR_NOT:
+            stack[sp++] = e->not.a;
+            break;
+        default:
+            break;
+        }
+
+        Expr_FreeItself(e);
+    }
+
+    if (stack != local) free(stack);
+}
+
+/* Constructors fill print_len from the children, so this never recurses
+ * more than one level. */
+uint32_t Expr_Length(expr_t *expr)
+{
+    if (expr->print_len != 0) {
+        return expr->print_len;
     }
 
-    switch (a->type) {
+    switch (expr->type) {
     case EXPR_IMPLIES:
-        return Expr_Equal(a->implies.a, b->implies.a) && Expr_Equal(a->implies.b, b->implies.b);
+        expr->print_len = 6 + Expr_Length(expr->implies.a) + Expr_Length(expr->implies.b);
         break;
-
     case EXPR_NOT:
-        return Expr_Equal(a->not.a, b->not.a);
+        expr->print_len = 1 + Expr_Length(expr->not.a);
         break;
-
     case EXPR_ATOM:
-        return strcmp(a->atom.name, b->atom.name) == 0;
+        expr->print_len = strlen(expr->atom.name);
         break;
     }
 
-    return 0;
+    return expr->print_len;
 }
 
+typedef struct {
+    expr_t *a, *b;
+} equal_item_t;
+
+int Expr_Equal(expr_t *a, expr_t *b)
+{
+    equal_item_t local[STACK_LOCAL];
+    equal_item_t *stack = local;
+    int sp = 0, cap = STACK_LOCAL;
+    stack[sp++] = (equal_item_t){ a, b };
+
+    int equal = 1;
+    while (sp > 0 && equal) {
+        equal_item_t item = stack[--sp];
+        a = item.a;
+        b = item.b;
+
+        if (a == b) {
+            continue;
+        }
+        if (Expr_Hash(a) != Expr_Hash(b) || a->type != b->type) {
+            equal = 0;
+            break;
+        }
+        if (sp + 2 > cap) stack = Expr_GrowStack(stack, local, &cap, sizeof(equal_item_t));
+
+        switch (a->type) {
+        case EXPR_IMPLIES:
+            stack[sp++] = (equal_item_t){ a->implies.b, b->implies.b };
+            stack[sp++] = (equal_item_t){ a->implies.a, b->implies.a };
+            break;
+
+        case EXPR_NOT:
+            stack[sp++] = (equal_item_t){ a->not.a, b->not.a };
+            break;
+
+        case EXPR_ATOM:
+            equal = strcmp(a->atom.name, b->atom.name) == 0;
+            break;
+        }
+    }
+
+    if (stack != local) free(stack);
+    return equal;
+}
+
+static void Expr_CalcHash(expr_t *e);
+
+/*
+ * Hash and print length are computed at construction from the children's,
+ * which are already known, so neither ever walks a whole formula.
+ */
 expr_t *Expr_Implies(expr_t *a, expr_t *b)
 {
     expr_t *expr = AllocExpr();
     expr->type = EXPR_IMPLIES;
     expr->implies.a = a;
     expr->implies.b = b;
+    Expr_CalcHash(expr);
+    expr->print_len = 6 + Expr_Length(a) + Expr_Length(b);
     return expr;
 }
 
@@ -132,6 +296,8 @@ expr_t *Expr_Not(expr_t *a)
     expr_t *expr = AllocExpr();
     expr->type = EXPR_NOT;
     expr->not.a = a;
+    Expr_CalcHash(expr);
+    expr->print_len = 1 + Expr_Length(a);
     return expr;
 }
 
@@ -140,27 +306,199 @@ expr_t *Expr_Atom(char *name)
     expr_t *expr = AllocExpr();
     expr->type = EXPR_ATOM;
     strcpy(expr->atom.name, name);
+    Expr_CalcHash(expr);
+    expr->print_len = strlen(name);
     return expr;
 }
 
+#define NAME atom_table
+#define KEY_TY expr_t*
+#define HASH_FN Expr_Hash
+#define CMPR_FN Expr_Equal
+#include "verstable.h"
+
+#define ATOM_BLOCK 4096
+
+static pthread_mutex_t atoms_lock = PTHREAD_MUTEX_INITIALIZER;
+static atom_table atoms;
+static bool atoms_init = false;
+static expr_t *atom_block = NULL;
+static int atom_idx = ATOM_BLOCK;
+
+/*
+ * Returns the shared atom named by the len bytes at name, which need not
+ * be NUL-terminated. Interned atoms live outside the arenas and are never
+ * freed, so formulas of every thread can share them; Expr_Free skips them.
+ * Returns NULL if the name does not fit an atom.
+ */
+expr_t *Expr_InternAtom(const char *name, int len)
+{
+    if (len <= 0 || len >= (int)sizeof(((expr_t *)0)->atom.name)) {
+        return NULL;
+    }
+
+    expr_t probe;
+    memset(&probe, 0, sizeof(probe));
+    probe.type = EXPR_ATOM;
+    memcpy(probe.atom.name, name, len);
+
+    pthread_mutex_lock(&atoms_lock);
+    if (!atoms_init) {
+        atoms_init = true;
+        atom_table_init(&atoms);
+    }
+
+    atom_table_itr iter = atom_table_get(&atoms, &probe);
+    if (!atom_table_is_end(iter)) {
+        pthread_mutex_unlock(&atoms_lock);
+        return iter.data->key;
+    }
+
+    if (atom_idx == ATOM_BLOCK) {
+        atom_block = malloc(ATOM_BLOCK * sizeof(expr_t));
+        if (atom_block == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+        atom_idx = 0;
+    }
+
+    expr_t *atom = atom_block + atom_idx++;
+    *atom = probe;
+    atom->print_len = len;
+    atom_table_insert(&atoms, atom);
+    pthread_mutex_unlock(&atoms_lock);
+    return atom;
+}
+
+static bool IsInterned(expr_t *e)
+{
+    return e < arena.exprs || e >= arena.exprs + ARENA_SIZE;
+}
+
+typedef struct {
+    expr_t *src;
+    expr_t **dst;
+} clone_item_t;
+
+/* Copies nodes in pre-order, like the recursive version did; interned atoms are shared. */
 expr_t *Expr_Clone(expr_t *expr)
 {
-    expr_t *new_expr = AllocExpr();
-    memcpy(new_expr, expr, sizeof(expr_t));
+    clone_item_t local[STACK_LOCAL];
+    clone_item_t *stack = local;
+    int sp = 0, cap = STACK_LOCAL;
 
-    switch (expr->type) {
-    case EXPR_IMPLIES:
-        new_expr->implies.a = Expr_Clone(expr->implies.a);
-        new_expr->implies.b = Expr_Clone(expr->implies.b);
-        break;
-    case EXPR_NOT:
-        new_expr->not.a = Expr_Clone(expr->not.a);
-        break;
-    default:
-        break;
+    expr_t *root;
+    stack[sp++] = (clone_item_t){ expr, &root };
+
+    while (sp > 0) {
+        clone_item_t item = stack[--sp];
+        expr_t *e = item.src;
+
+        if (e->type == EXPR_ATOM && IsInterned(e)) {
+            *item.dst = e;
+            continue;
+        }
+
+        expr_t *copy = AllocExpr();
+        memcpy(copy, e, sizeof(expr_t));
+        *item.dst = copy;
+        if (sp + 2 > cap) stack = Expr_GrowStack(stack, local, &cap, sizeof(clone_item_t));
+
+        switch (e->type) {
+        case EXPR_IMPLIES:
+            stack[sp++] = (clone_item_t){ e->implies.b, &copy->implies.b };
+            stack[sp++] = (clone_item_t){ e->implies.a, &copy->implies.a };
+            break;
+        case EXPR_NOT:
+            stack[sp++] = (clone_item_t){ e->not.a, &copy->not.a };
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (stack != local) free(stack);
+    return root;
+}
+
+typedef struct {
+    expr_t *e;
+    int state;
+} subst_frame_t;
+
+/* Instance of an axiom schema: A, B and C are replaced by clones of the substitutes. */
+expr_t *Expr_Substitute(expr_t *template, expr_t *subA, expr_t *subB, expr_t *subC)
+{
+    subst_frame_t frames_local[STACK_LOCAL];
+    subst_frame_t *frames = frames_local;
+    int sp = 0, cap = STACK_LOCAL;
+
+    expr_t *values_local[STACK_LOCAL];
+    expr_t **values = values_local;
+    int vp = 0, vcap = STACK_LOCAL;
+
+    frames[sp++] = (subst_frame_t){ template, 0 };
+    while (sp > 0) {
+        subst_frame_t *f = &frames[sp - 1];
+        expr_t *t = f->e;
+
+        if (vp + 1 > vcap) values = Expr_GrowStack(values, values_local, &vcap, sizeof(expr_t *));
+
+        if (f->state == 1) {
+            sp--;
+            if (t->type == EXPR_IMPLIES) {
+                expr_t *b = values[--vp];
+                expr_t *a = values[--vp];
+                values[vp++] = Expr_Implies(a, b);
+            }
+            else {
+                expr_t *a = values[--vp];
+                values[vp++] = Expr_Not(a);
+            }
+            continue;
+        }
+
+        switch (t->type) {
+        case EXPR_ATOM: {
+            expr_t *sub = NULL;
+            if (strcmp(t->atom.name, "A") == 0 && subA != NULL) sub = Expr_Clone(subA);
+            else if (strcmp(t->atom.name, "B") == 0 && subB != NULL) sub = Expr_Clone(subB);
+            else if (strcmp(t->atom.name, "C") == 0 && subC != NULL) sub = Expr_Clone(subC);
+            else {
+                /* The prover only instantiates schemas over A, B and C. */
+                fprintf(stderr, "Unbound schema variable %s\n", t->atom.name);
+                exit(1);
+            }
+            values[vp++] = sub;
+            sp--;
+            break;
+        }
+
+        case EXPR_IMPLIES:
+            f->state = 1;
+            if (sp + 2 > cap) frames = Expr_GrowStack(frames, frames_local, &cap, sizeof(subst_frame_t));
+            frames[sp++] = (subst_frame_t){ t->implies.b, 0 };
+            frames[sp++] = (subst_frame_t){ t->implies.a, 0 };
+            break;
+    
+        case EXPR_NOT:
+            f->state = 1;
+            if (sp + 1 > cap) frames = Expr_GrowStack(frames, frames_local, &cap, sizeof(subst_frame_t));
+            frames[sp++] = (subst_frame_t){ t->not.a, 0 };
+            break;
+    
+        default:
+            ASSERT(0, "Unknown expression type");
+            sp--;
+            break;
+        }
     }
 
-    return new_expr;
+    expr_t *res = vp > 0 ? values[0] : NULL;
+    if (frames != frames_local) free(frames);
+    if (values != values_local) free(values);
+    return res;
 }
 
 #define HASH_SEED 33
@@ -1,6 +1,8 @@
 #ifndef EXPR_H
 #define EXPR_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 typedef enum {
@@ -13,6 +15,7 @@ struct expr_t;
 typedef struct expr_t {
     uint64_t hash;
     expr_type_t type;
+    uint32_t print_len;
 
     union {
         struct {
@@ -29,16 +32,48 @@ typedef struct expr_t {
     };
 } expr_t;
 
-int Expr_Print(expr_t *expr);
+uint32_t Expr_Length(expr_t *expr);
 int Expr_Equal(expr_t *a, expr_t *b);
 
 expr_t *Expr_Implies(expr_t *a, expr_t *b);
 expr_t *Expr_Not(expr_t *a);
 expr_t *Expr_Atom(char *name);
+expr_t *Expr_InternAtom(const char *name, int len);
 void    Expr_Free(expr_t* expr);
+/* Frees only the node, not its children. */
+void    Expr_FreeItself(expr_t* expr);
+expr_t *Expr_AllocArray(int n);
 expr_t *Expr_Clone(expr_t *expr);
+expr_t *Expr_Substitute(expr_t *template, expr_t *A, expr_t *B, expr_t *C);
+
+typedef struct {
+    expr_t *exprs;
+    int idx;
+    int *frees;
+    int free_count;
+    int alloc_cnt;
+    int free_cnt;
+} expr_arena_t;
+
+/* Expressions per arena. Running out ends the process; see +max-exprs. */
+#define ARENA_SIZE 10000000
+
+typedef struct {
+    int arena_idx;
+} expr_mark_t;
+
+expr_mark_t Expr_Mark(void);
+void Expr_Release(expr_mark_t mark);
+int  Expr_ArenaUsed(void);
+void Expr_SetExitReport(bool enabled);
+void Expr_SwapArena(expr_arena_t *a);
+void Expr_FreeArena(void);
 
 void Expr_HashImpl(expr_t *e, uint64_t *hash);
+
+/* Explicit traversal stacks start in a local buffer of the caller and grow
+ * onto the heap, so walks are only limited by memory. */
+void *Expr_GrowStack(void *stack, void *local, int *cap, size_t elem_size);
 uint64_t Expr_Hash(expr_t *e);
 
 #ifdef PARANOID
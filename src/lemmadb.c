@@ -0,0 +1,518 @@
+#include "lemmadb.h"
+#include "canon.h"
+#include "check.h"
+#include "schema.h"
+#include "proofbin.h"
+#include "writer.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static size_t Align8(size_t size)
+{
+    return (size + 7) & ~(size_t)7;
+}
+
+static int Remap(lemmadb_t *db)
+{
+    if (db->base != NULL) munmap(db->base, db->size);
+    db->base = NULL;
+    db->size = 0;
+
+    struct stat st;
+    if (fstat(db->fd, &st) != 0) return -1;
+    if (st.st_size == 0) return 0;
+
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, db->fd, 0);
+    if (base == MAP_FAILED) return -1;
+
+    db->base = base;
+    db->size = st.st_size;
+    return 0;
+}
+
+static void Index(lemmadb_t *db, uint64_t hash, uint32_t entry)
+{
+    size_t size = lemma_index_size(&db->index);
+    lemma_index_get_or_insert(&db->index, hash, entry);
+    if (lemma_index_size(&db->index) != size) return;
+
+    if (db->collision_count == db->collision_cap) {
+        db->collision_cap = db->collision_cap ? db->collision_cap * 2 : 16;
+        db->collisions = realloc(db->collisions, db->collision_cap * sizeof(lemma_ref_t));
+        if (db->collisions == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+    db->collisions[db->collision_count++] = (lemma_ref_t){ hash, entry };
+}
+
+static int ViewRecord(lemmadb_t *db, uint64_t offset, proofbin_map_t *map)
+{
+    const lemmadb_record_t *rec = (const lemmadb_record_t *)(db->base + offset);
+    memset(map, 0, sizeof(proofbin_map_t));
+    return ProofBin_View(rec + 1, rec->size, map);
+}
+
+/*
+ * The number of canonical atoms the proven formulas of a record use, i.e.
+ * one past the highest canonical index among them; atoms that only occur
+ * in the schemas (A, B, C) or in unused bindings don't count. Nodes only
+ * point backwards, so one reverse sweep finds them. UINT32_MAX if the
+ * record is unreadable or not canonical, which no goal can use.
+ */
+static uint32_t RecordAtoms(lemmadb_t *db, uint64_t offset)
+{
+    proofbin_map_t map;
+    if (ViewRecord(db, offset, &map) != 0) return UINT32_MAX;
+
+    const proofbin_header_t *h = map.header;
+    bool *used = calloc(h->node_count + 1, sizeof(bool));
+    if (used == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    uint32_t atoms = 0;
+
+    for (uint32_t i = 0; i < h->step_count; i++) {
+        if (map.steps[i].formula < h->node_count) used[map.steps[i].formula] = true;
+    }
+
+    for (uint32_t i = h->node_count; atoms != UINT32_MAX && i-- > 0;) {
+        if (!used[i]) continue;
+
+        const proofbin_node_t *node = &map.nodes[i];
+        switch (node->type) {
+        case EXPR_IMPLIES:
+            if (node->a < i) used[node->a] = true;
+            if (node->b < i) used[node->b] = true;
+            break;
+        case EXPR_NOT:
+            if (node->a < i) used[node->a] = true;
+            break;
+        case EXPR_ATOM: {
+            int idx = -1;
+            if (node->a < h->atom_count) {
+                const proofbin_atom_t *atom = &map.atoms[node->a];
+                if ((uint64_t)atom->offset + atom->len <= h->strtab_size) {
+                    idx = Canon_Index(map.strtab + atom->offset, atom->len);
+                }
+            }
+            /* Canonical names are handed out in order, so k names need k atoms. */
+            if (idx < 0 || (uint32_t)idx >= h->atom_count) atoms = UINT32_MAX;
+            else if ((uint32_t)idx + 1 > atoms) atoms = idx + 1;
+            break;
+        }
+        }
+    }
+
+    free(used);
+    return atoms;
+}
+
+static void AddEntry(lemmadb_t *db, uint64_t hash, uint64_t offset)
+{
+    if (db->entry_count == db->entry_cap) {
+        db->entry_cap = db->entry_cap ? db->entry_cap * 2 : 64;
+        db->entries = realloc(db->entries, db->entry_cap * sizeof(lemma_entry_t));
+        if (db->entries == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+
+    uint32_t entry = db->entry_count++;
+    uint32_t atoms = RecordAtoms(db, offset);
+    db->entries[entry] = (lemma_entry_t){ offset, atoms, LEMMADB_UNCHECKED };
+    Index(db, hash, entry);
+    if (atoms == UINT32_MAX) return;
+
+    if (atoms >= db->bucket_count) {
+        db->buckets = realloc(db->buckets, (atoms + 1) * sizeof(lemma_bucket_t));
+        if (db->buckets == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+        memset(db->buckets + db->bucket_count, 0, (atoms + 1 - db->bucket_count) * sizeof(lemma_bucket_t));
+        db->bucket_count = atoms + 1;
+    }
+
+    lemma_bucket_t *bucket = &db->buckets[atoms];
+    if (bucket->count == bucket->cap) {
+        bucket->cap = bucket->cap ? bucket->cap * 2 : 16;
+        bucket->entries = realloc(bucket->entries, bucket->cap * sizeof(uint32_t));
+        if (bucket->entries == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+    bucket->entries[bucket->count++] = entry;
+}
+
+/* Adds an entry for each complete record past db->scanned; a torn record at the end is left alone. */
+static void Scan(lemmadb_t *db)
+{
+    size_t offset = db->scanned;
+    while (offset + sizeof(lemmadb_record_t) <= db->size) {
+        const lemmadb_record_t *rec = (const lemmadb_record_t *)(db->base + offset);
+        size_t next = offset + sizeof(lemmadb_record_t) + Align8(rec->size);
+        if (next > db->size) break;
+
+        AddEntry(db, rec->hash, offset);
+        offset = next;
+    }
+    db->scanned = offset;
+}
+
+int LemmaDb_Open(lemmadb_t *db, const char *path)
+{
+    memset(db, 0, sizeof(lemmadb_t));
+    lemma_index_init(&db->index);
+
+    db->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (db->fd < 0) return -1;
+
+    flock(db->fd, LOCK_EX);
+    struct stat st;
+    if (fstat(db->fd, &st) == 0 && st.st_size == 0) {
+        lemmadb_header_t header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, LEMMADB_MAGIC, sizeof(LEMMADB_MAGIC));
+        header.version = LEMMADB_VERSION;
+        if (pwrite(db->fd, &header, sizeof(header), 0) != sizeof(header)) {
+            flock(db->fd, LOCK_UN);
+            LemmaDb_Close(db);
+            return -1;
+        }
+    }
+    flock(db->fd, LOCK_UN);
+
+    if (Remap(db) != 0 || db->size < sizeof(lemmadb_header_t)) {
+        LemmaDb_Close(db);
+        return -1;
+    }
+
+    const lemmadb_header_t *header = (const lemmadb_header_t *)db->base;
+    if (memcmp(header->magic, LEMMADB_MAGIC, sizeof(LEMMADB_MAGIC)) != 0 ||
+        header->version != LEMMADB_VERSION) {
+        LemmaDb_Close(db);
+        return -1;
+    }
+
+    db->scanned = sizeof(lemmadb_header_t);
+    Scan(db);
+    return 0;
+}
+
+void LemmaDb_Close(lemmadb_t *db)
+{
+    if (db->base != NULL) munmap(db->base, db->size);
+    if (db->fd >= 0) close(db->fd);
+    lemma_index_cleanup(&db->index);
+    free(db->collisions);
+    free(db->entries);
+    for (uint32_t k = 0; k < db->bucket_count; k++) free(db->buckets[k].entries);
+    free(db->buckets);
+    memset(db, 0, sizeof(lemmadb_t));
+    db->fd = -1;
+}
+
+typedef struct {
+    uint32_t id;
+    expr_t *e;
+} node_item_t;
+
+/* Compares a node of a stored proof with e without loading the proof. */
+static bool NodeEquals(proofbin_map_t *map, uint32_t id, expr_t *e)
+{
+    node_item_t local[64];
+    node_item_t *stack = local;
+    int sp = 0, cap = 64;
+    stack[sp++] = (node_item_t){ id, e };
+
+    bool equal = true;
+    while (sp > 0 && equal) {
+        node_item_t item = stack[--sp];
+        id = item.id;
+        e = item.e;
+
+        if (id >= map->header->node_count) {
+            equal = false;
+            break;
+        }
+        const proofbin_node_t *node = &map->nodes[id];
+        if (node->type != e->type) {
+            equal = false;
+            break;
+        }
+        if (sp + 2 > cap) stack = Expr_GrowStack(stack, local, &cap, sizeof(node_item_t));
+
+        switch (e->type) {
+        case EXPR_IMPLIES:
+            equal = node->a < id && node->b < id;
+            stack[sp++] = (node_item_t){ node->b, e->implies.b };
+            stack[sp++] = (node_item_t){ node->a, e->implies.a };
+            break;
+        case EXPR_NOT:
+            equal = node->a < id;
+            stack[sp++] = (node_item_t){ node->a, e->not.a };
+            break;
+        case EXPR_ATOM: {
+            if (node->a >= map->header->atom_count) {
+                equal = false;
+                break;
+            }
+            const proofbin_atom_t *atom = &map->atoms[node->a];
+            equal = atom->len == Expr_Length(e) &&
+                    (uint64_t)atom->offset + atom->len <= map->header->strtab_size &&
+                    memcmp(map->strtab + atom->offset, e->atom.name, atom->len) == 0;
+            break;
+        }
+        }
+    }
+
+    if (stack != local) free(stack);
+    return equal;
+}
+
+static bool RecordProves(lemmadb_t *db, uint32_t entry, expr_t *e)
+{
+    proofbin_map_t map;
+    return ViewRecord(db, db->entries[entry].offset, &map) == 0 && NodeEquals(&map, map.header->goal, e);
+}
+
+/*
+ * A stored proof is only used if it checks against our axioms: a record
+ * written for other axioms, or a corrupt one, must not become a proof.
+ * The verdict is kept in the entry, so each record is checked once.
+ */
+static int LoadRecord(lemmadb_t *db, uint32_t entry, expr_t **axioms, int axiom_count, proof_t *proof)
+{
+    lemma_entry_t *en = &db->entries[entry];
+    if (en->state == LEMMADB_INVALID) return -1;
+
+    proofbin_map_t map;
+    Proof_Init(proof);
+    bool ok = ViewRecord(db, en->offset, &map) == 0 && ProofBin_Load(&map, proof) == 0 && proof->count > 0;
+    if (ok && en->state == LEMMADB_UNCHECKED) {
+        check_result_t res;
+        Check_Proof(proof, axioms, axiom_count, 1, &res);
+        ok = res.failed_at < 0;
+    }
+
+    en->state = ok ? LEMMADB_VALID : LEMMADB_INVALID;
+    if (!ok) {
+        Proof_Free(proof);
+        return -1;
+    }
+    return 0;
+}
+
+static int TryRecord(lemmadb_t *db, uint32_t entry, expr_t *goal,
+                     expr_t **axioms, int axiom_count, proof_t *proof)
+{
+    if (!RecordProves(db, entry, goal)) return -1;
+
+    proof_t candidate;
+    if (LoadRecord(db, entry, axioms, axiom_count, &candidate) != 0) return -1;
+
+    Proof_Free(proof);
+    *proof = candidate;
+    return 0;
+}
+
+/*
+ * Looks the goal up by its canonical form and renames the stored proof
+ * back to the goal's atoms.
+ */
+int LemmaDb_Find(lemmadb_t *db, expr_t *goal, expr_t **axioms, int axiom_count, proof_t *proof)
+{
+    renaming_t canon, inverse;
+    Canon_Init(&canon);
+    Canon_Build(&canon, goal);
+
+    expr_t *key = Canon_Apply(&canon, goal);
+    uint64_t hash = Expr_Hash(key);
+    int res = -1;
+
+    lemma_index_itr iter = lemma_index_get(&db->index, hash);
+    if (!lemma_index_is_end(iter)) {
+        res = TryRecord(db, iter.data->val, key, axioms, axiom_count, proof);
+        for (int i = 0; i < db->collision_count && res != 0; i++) {
+            if (db->collisions[i].hash != hash) continue;
+            res = TryRecord(db, db->collisions[i].entry, key, axioms, axiom_count, proof);
+        }
+    }
+
+    if (res == 0) {
+        Canon_Invert(&canon, &inverse);
+        Canon_ApplyProof(&inverse, proof);
+        Canon_Free(&inverse);
+    }
+
+    Expr_Free(key);
+    Canon_Free(&canon);
+    return res;
+}
+
+static bool Contains(lemmadb_t *db, expr_t *e)
+{
+    uint64_t hash = Expr_Hash(e);
+
+    lemma_index_itr iter = lemma_index_get(&db->index, hash);
+    if (lemma_index_is_end(iter)) return false;
+    if (RecordProves(db, iter.data->val, e)) return true;
+
+    for (int i = 0; i < db->collision_count; i++) {
+        if (db->collisions[i].hash == hash && RecordProves(db, db->collisions[i].entry, e)) return true;
+    }
+    return false;
+}
+
+/*
+ * Appends the proof in canonical form (atoms renamed in order of first
+ * occurrence in the goal, then in the remaining steps) unless an
+ * alpha-equivalent formula is already stored. The file is locked while
+ * appending, so concurrent provers can share one database; records they
+ * appended meanwhile are indexed as well.
+ */
+int LemmaDb_Add(lemmadb_t *db, proof_t *proof)
+{
+    if (proof->count == 0) return -1;
+
+    renaming_t canon;
+    Canon_Init(&canon);
+    Canon_Build(&canon, proof->steps[proof->count - 1].e);
+
+    proof_t canonical;
+    Proof_Init(&canonical);
+    for (int i = 0; i < proof->count; i++) {
+        Canon_Build(&canon, proof->steps[i].e);
+        Proof_Push(&canonical, &proof->steps[i]);
+    }
+    Canon_ApplyProof(&canon, &canonical);
+    Canon_Free(&canon);
+
+    expr_t *e = canonical.steps[canonical.count - 1].e;
+    uint64_t hash = Expr_Hash(e);
+
+    writer_t w;
+    Writer_Init(&w, -1);
+    Writer_Pad(&w, '\0', sizeof(lemmadb_record_t));
+    ProofBin_Encode(&w, &canonical);
+
+    lemmadb_record_t *rec = (lemmadb_record_t *)w.buf;
+    rec->hash = hash;
+    rec->size = w.len - sizeof(lemmadb_record_t);
+    rec->reserved = 0;
+    Writer_Pad(&w, '\0', Align8(w.len) - w.len);
+
+    int res = 0;
+    flock(db->fd, LOCK_EX);
+
+    Remap(db);
+    Scan(db);
+
+    bool known = Contains(db, e);
+    if (!known) {
+        if (db->scanned != db->size && ftruncate(db->fd, db->scanned) != 0) res = -1;
+        if (res == 0 && pwrite(db->fd, w.buf, w.len, db->scanned) != (ssize_t)w.len) res = -1;
+    }
+
+    flock(db->fd, LOCK_UN);
+    if (Writer_Free(&w) != 0) res = -1;
+    Proof_Free(&canonical);
+
+    Remap(db);
+    Scan(db);
+    return res;
+}
+
+static int CompareEntries(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Appends to lemmas the steps of every stored proof that can be stated
+ * over the goal's atoms, so RunInference can use them once they are in
+ * the pool; premises are renumbered to point into lemmas. Records are
+ * canonical, so their atoms are renamed with the inverse of the goal's own
+ * canonical renaming, and only the buckets of records using at most as
+ * many atoms as the goal are visited, in file order. Returns the number of
+ * records used.
+ */
+int LemmaDb_Seed(lemmadb_t *db, expr_t *goal, expr_t **axioms, int axiom_count, proof_t *lemmas)
+{
+    renaming_t canon, inverse;
+    Canon_Init(&canon);
+    Canon_Build(&canon, goal);
+    Canon_Invert(&canon, &inverse);
+    Canon_Free(&canon);
+
+    uint32_t buckets = (uint32_t)inverse.count + 1 < db->bucket_count ? (uint32_t)inverse.count + 1 : db->bucket_count;
+    int count = 0;
+    for (uint32_t k = 0; k < buckets; k++) count += db->buckets[k].count;
+
+    uint32_t *candidates = malloc((count + 1) * sizeof(uint32_t));
+    if (candidates == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    count = 0;
+    for (uint32_t k = 0; k < buckets; k++) {
+        lemma_bucket_t *bucket = &db->buckets[k];
+        memcpy(candidates + count, bucket->entries, bucket->count * sizeof(uint32_t));
+        count += bucket->count;
+    }
+    qsort(candidates, count, sizeof(uint32_t), CompareEntries);
+
+    int seeded = 0;
+    for (int j = 0; j < count; j++) {
+        proof_t proof;
+        if (LoadRecord(db, candidates[j], axioms, axiom_count, &proof) != 0) continue;
+        Canon_ApplyProof(&inverse, &proof);
+
+        int base = lemmas->count;
+        for (int i = 0; i < proof.count; i++) {
+            proof_step_t step = proof.steps[i];
+            if (step.type == INFERENCE_MODUS_PONENS) {
+                step.modus_ponens.A_impl_B += base;
+                step.modus_ponens.A += base;
+            }
+            Proof_Push(lemmas, &step);
+        }
+
+        Proof_Free(&proof);
+        seeded++;
+    }
+
+    free(candidates);
+    Canon_Free(&inverse);
+    return seeded;
+}
+
+/*
+ * Derives a schema from every stored proof that only uses our axioms (see
+ * schema.h). Returns the number of schemas added.
+ */
+int LemmaDb_Schemas(lemmadb_t *db, expr_t **axioms, int axiom_count, schema_list_t *list)
+{
+    int derived = 0;
+
+    for (uint32_t entry = 0; entry < db->entry_count; entry++) {
+        proof_t proof;
+        if (LoadRecord(db, entry, axioms, axiom_count, &proof) != 0) continue;
+        if (Schema_Derive(list, &proof, axioms, axiom_count) == 0) derived++;
+        Proof_Free(&proof);
+    }
+
+    return derived;
+}
@@ -0,0 +1,92 @@
+#ifndef LEMMADB_H
+#define LEMMADB_H
+
+#include "proof.h"
+#include "schema.h"
+#include <stdint.h>
+
+/*
+ * Append-only file of proven formulas. After a small header the file is a
+ * sequence of records, each a lemmadb_record_t followed by the proof in
+ * the binary proof format (see proofbin.h), padded to 8 bytes. Records
+ * are keyed by Expr_Hash of the proven formula, i.e. the last proof step.
+ * Proofs are stored with their atoms canonically renamed (see canon.h), so
+ * one record serves every alpha-equivalent goal.
+ *
+ * An open database keeps an entry per record. Index and collisions map
+ * formula hashes to entries, and buckets[k] lists the entries whose proven
+ * formulas use k canonical atoms, so seeding a goal with n atoms only
+ * visits buckets 0..n. Whether a record checks against the axioms is
+ * found out the first time it is loaded and kept in its entry; a database
+ * is used with the axioms of one session only.
+ */
+
+#define LEMMADB_MAGIC   "MPLEMMA"
+#define LEMMADB_VERSION 2
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+} lemmadb_header_t;
+
+typedef struct {
+    uint64_t hash;
+    uint32_t size;
+    uint32_t reserved;
+} lemmadb_record_t;
+
+#define NAME lemma_index
+#define KEY_TY uint64_t
+#define VAL_TY uint64_t
+#include "verstable.h"
+
+typedef struct {
+    uint64_t hash;
+    uint64_t entry;
+} lemma_ref_t;
+
+#define LEMMADB_UNCHECKED -1
+#define LEMMADB_INVALID    0
+#define LEMMADB_VALID      1
+
+typedef struct {
+    uint64_t offset;
+    uint32_t atoms;
+    int32_t state;
+} lemma_entry_t;
+
+typedef struct {
+    uint32_t *entries;
+    int count;
+    int cap;
+} lemma_bucket_t;
+
+typedef struct {
+    int fd;
+    char *base;
+    size_t size;
+    size_t scanned;
+
+    lemma_entry_t *entries;
+    uint32_t entry_count;
+    uint32_t entry_cap;
+
+    lemma_index index;
+    lemma_ref_t *collisions;
+    int collision_count;
+    int collision_cap;
+
+    lemma_bucket_t *buckets;
+    uint32_t bucket_count;
+} lemmadb_t;
+
+int  LemmaDb_Open(lemmadb_t *db, const char *path);
+void LemmaDb_Close(lemmadb_t *db);
+
+int  LemmaDb_Find(lemmadb_t *db, expr_t *goal, expr_t **axioms, int axiom_count, proof_t *proof);
+int  LemmaDb_Add(lemmadb_t *db, proof_t *proof);
+int  LemmaDb_Seed(lemmadb_t *db, expr_t *goal, expr_t **axioms, int axiom_count, proof_t *lemmas);
+int  LemmaDb_Schemas(lemmadb_t *db, expr_t **axioms, int axiom_count, schema_list_t *list);
+
+#endif
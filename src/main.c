@@ -1,407 +1,362 @@
+#include "prover.h"
+#include "check.h"
 #include "parser.h"
-#include <stdint.h>
+#include "portfolio.h"
+#include "proofbin.h"
+#include "server.h"
+#include "source.h"
+#include "trace.h"
+#include "writer.h"
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 #define MAX_EXPRS 100000
 #define MAX_TERMS 1000
-
-typedef enum {
-    INFERENCE_AXIOM,
-    INFERENCE_MODUS_PONENS,
-    INFERENCE_DEDUCTION
-} inference_type_t;
-
-typedef struct true_expr_t {
-    expr_t *e;
-    inference_type_t type;
-    int idx;
-
-    union {
-        struct {
-            expr_t *axiom;
-            expr_t *A, *B, *C;
-        } axiom;
-        
-        struct {
-            struct expr_t *A_impl_B;
-            struct expr_t *A;
-        } modus_ponens;
-
-        struct {
-            // todo;
-        } deduction;
-    };
-    
-    int printed;
-    bool visited;
-} true_expr_t;
-
-uint64_t TrueExpr_Hash(true_expr_t te)
-{
-    return Expr_Hash(te.e);
-}
-
-bool TrueExpr_Cmp(true_expr_t a, true_expr_t b)
+#define BATCH_IN_FLIGHT 64
+
+static prover_options_t options;
+static int print_history = -1;
+static int batch_mode = 0;
+static int batch_threads = 1;
+static long batch_slice = 0;
+static const char *proof_bin_path = NULL;
+static const char *serve_path = NULL;
+static int portfolio = 0;
+static int stats_mode = 0;
+static const char *trace_path = NULL;
+static long trace_min_us = 0;
+static prover_stats_t batch_stats;
+
+int EmitProof(proof_t *proof)
 {
-    return Expr_Equal(a.e, b.e);
-}
-
-#define NAME pool_map
-#define KEY_TY expr_t*
-#define VAL_TY true_expr_t
-#define HASH_FN Expr_Hash
-#define CMPR_FN Expr_Equal
-#include "verstable.h"
-
-#define NAME terms_set
-#define KEY_TY expr_t*
-#define HASH_FN Expr_Hash
-#define CMPR_FN Expr_Equal
-#include "verstable.h"
+    if (print_history) Proof_Print(&out, proof);
 
-pool_map pool;
-terms_set terms;
-
-static int print_axioms = 0;
-static int print_history = 1;
-static int add_neg_terms = 0;
-static int add_self_impl = 0;
-
-#define NOT_FOUND -1
-
-true_expr_t *FindExprInPool(expr_t *e)
-{
-    pool_map_itr iter = pool_map_get(&pool, e);
-    if (pool_map_is_end(iter)) {
-        return NULL;
+    if (proof_bin_path != NULL && ProofBin_Write(proof_bin_path, proof) != 0) {
+        fprintf(stderr, "failed to write %s\n", proof_bin_path);
+        return 1;
     }
-    return &iter.data->val;
+    return 0;
 }
 
-expr_t *FindExprInTerms(expr_t *e)
+int CheckMain(char **argv)
 {
-    terms_set_itr iter = terms_set_get(&terms, e);
-    if (terms_set_is_end(iter)) {
-        return NULL;
+    if (*argv == NULL) {
+        printf("specify proof file\n");
+        return 1;
     }
-    return iter.data->key;
-}
-
-void TrueExpr_Init(true_expr_t *te, expr_t *e)
-{
-    te->e = e;
-    te->printed = 0;
-    te->idx = pool_map_size(&pool);
-    te->visited = false;
-}
-
-void AddToPool(true_expr_t* te)
-{
-    pool_map_itr iter = pool_map_insert(&pool, te->e, *te);
-}
 
-void TrueExpr_ModusPonens(true_expr_t *te, expr_t *A_impl_B, expr_t *A)
-{
-    te->type = INFERENCE_MODUS_PONENS;
-    te->modus_ponens.A = A;
-    te->modus_ponens.A_impl_B = A_impl_B;
-}
+    if (argv[1] == NULL) {
+        printf("specify axioms file\n");
+        return 1;
+    }
 
-void TrueExpr_Axiom(true_expr_t *te, expr_t *axiom, expr_t *A, expr_t *B, expr_t *C)
-{
-    te->type = INFERENCE_AXIOM;
-    te->axiom.axiom = axiom;
-    te->axiom.A = A;
-    te->axiom.B = B;
-    te->axiom.C = C;
-}
+    expr_t **axioms = NULL;
+    int axiom_count = ReadAxioms(argv[1], &axioms);
+    if (axiom_count < 0) {
+        printf("failed to open file");
+        return 1;
+    }
 
-void TrueExpr_Deduction(true_expr_t *te)
-{
-    te->type = INFERENCE_DEDUCTION;
+    return Check_Run(argv[0], axioms, axiom_count);
 }
 
-void AddTerm(expr_t* e)
+/* Races the portfolio on the goal and prints the winner's output and proof. */
+int PortfolioMain(prover_ctx_t *ctx, const char *begin, const char *end)
 {
-    terms_set_insert(&terms, e);
-}
+    portfolio_t pf;
+    Portfolio_Init(&pf, ctx);
+
+    prover_ctx_t *winner = Portfolio_Prove(&pf, begin, end);
+    int failed = 1;
+    if (winner != NULL) {
+        writer_t *output = &pf.entrants[pf.winner].output;
+        Writer_Put(&out, output->buf, output->len);
+        Writer_Str(&out, "Portfolio winner: ");
+        Portfolio_WriteName(&pf, pf.winner, &out);
+        Writer_Char(&out, '\n');
+        failed = EmitProof(Prover_Proof(winner));
+    }
 
-void ExtractSubformulas(expr_t* e, int negate)
-{
-    switch (e->type) {
-    case EXPR_ATOM:
-        break;
-    case EXPR_IMPLIES:
-        ExtractSubformulas(e->implies.a, negate);
-        ExtractSubformulas(e->implies.b, negate);
-        break;
-    case EXPR_NOT:
-        ExtractSubformulas(e->not.a, !negate);
-        break;
-    default:
-        ASSERT(0, "Unknown expression type");
-        break;
+    for (int i = 0; i < pf.count; i++) {
+        Stats_Merge(&ctx->stats, &pf.entrants[i].ctx->stats);
     }
-    
-    if (negate) AddTerm(Expr_Not(e));
-    else AddTerm(e);
+    Portfolio_Free(&pf);
+    return failed;
 }
 
-expr_t* Substitute(expr_t* template, expr_t* subA, expr_t* subB, expr_t* subC)
+/*
+ * Proves the goal on [begin, end) and writes its record to out. Returns
+ * true if it was proven. A goal that does not parse gets an error record.
+ */
+bool BatchGoal(prover_ctx_t *ctx, int n, const char *begin, const char *end)
 {
-    switch (template->type) {
-    case EXPR_ATOM:
-        if (strcmp(template->atom.name, "A") == 0 && subA != NULL) return Expr_Clone(subA);
-        if (strcmp(template->atom.name, "B") == 0 && subB != NULL) return Expr_Clone(subB);
-        if (strcmp(template->atom.name, "C") == 0 && subC != NULL) return Expr_Clone(subC);
-        ASSERT(0, "Every 'variable' should be replaced");
-        break;
-
-    case EXPR_IMPLIES:
-        return Expr_Implies(
-            Substitute(template->implies.a, subA, subB, subC),
-            Substitute(template->implies.b, subA, subB, subC)
-        );
-    
-    case EXPR_NOT:
-        return Expr_Not(
-            Substitute(template->not.a, subA, subB, subC)
-        );
-    
-    default:
-        ASSERT(0, "Unknown expression type");
-        break;
+    const char *expected = Parser_Check(begin, end);
+    if (expected != NULL) {
+        Prover_WriteErrorRecord(&out, n, expected);
+        return false;
     }
 
-    return NULL;
+    Prover_SetGoal(ctx, begin, end);
+    bool found = Prover_Prove(ctx);
+    Prover_WriteRecord(ctx, &out, n, print_history == 1);
+    Prover_Reset(ctx);
+    return found;
 }
 
-void PrintAxiom(true_expr_t *te)
+typedef struct {
+    const char *begin, *end;
+    prover_ctx_t *ctx;
+    writer_t record;
+    bool found;
+    bool done;
+} batch_job_t;
+
+typedef struct {
+    prover_ctx_t *root;
+    batch_job_t *jobs;
+    int count;
+    int next;
+
+    /* Jobs between Prover_Start and their last Prover_Step, round-robin. */
+    int *ready;
+    int ready_head;
+    int ready_count;
+    int in_flight;
+    int max_in_flight;
+
+    prover_ctx_t **spare;
+    int spare_count;
+
+    pthread_mutex_t lock;
+    pthread_cond_t runnable;
+    pthread_cond_t done;
+} batch_t;
+
+/* Moves what the prover wrote to the thread's out into the job's record. */
+static void BatchCollect(batch_job_t *job)
 {
-    printf("   Axiom = ");
-    Expr_Print(te->axiom.axiom);
-    printf("\n       A = ");
-    Expr_Print(te->axiom.A);
-    printf("\n       B = ");
-    Expr_Print(te->axiom.B);
-    printf("\n       C = ");
-    Expr_Print(te->axiom.C);
-    printf("\n");
-
-    printf("  %3d ", te->idx);
-    Expr_Print(te->e);
-    printf("\n\n");
+    Writer_Put(&job->record, out.buf, out.len);
+    out.len = 0;
 }
 
-void PrintModusPonens(true_expr_t *te)
+/*
+ * Runs one slice of a goal per turn: admits the next goal while fewer than
+ * max_in_flight are under way, otherwise resumes the goal at the head of
+ * the ready queue, and puts it back at the tail if it needs more time. A
+ * goal may be resumed on any worker, since its context carries its state.
+ */
+static void *BatchWorker(void *arg)
 {
-    true_expr_t *A_impl_B = FindExprInPool(te->modus_ponens.A_impl_B);
-    true_expr_t *A = FindExprInPool(te->modus_ponens.A);
-
-    printf("%5d ", A_impl_B->idx);
-    Expr_Print(A_impl_B->e);
-    printf(",\n%5d  ", A->idx); 
-    int len = Expr_Print(A->e);
-    printf("\n%5d ", te->idx);
-    while (len--) putc(' ', stdout);
-    printf("  |- ");
-    Expr_Print(te->e);
-    printf("\n\n");
-}
-
-void InstantiateAxiom(expr_t* ax)
-{
-    if (print_axioms) {
-        printf("Axiom: ");
-        Expr_Print(ax);
-        printf("\n");
-    }
-
-    terms_set_itr begin = terms_set_first(&terms);
-    for (terms_set_itr it_i = begin; !terms_set_is_end(it_i); it_i = terms_set_next(it_i)) {
-        for (terms_set_itr it_j = begin; !terms_set_is_end(it_j); it_j = terms_set_next(it_j)) {
-            for (terms_set_itr it_k = begin; !terms_set_is_end(it_k); it_k = terms_set_next(it_k)) {
-                expr_t *A = it_i.data->key;
-                expr_t *B = it_j.data->key;
-                expr_t *C = it_k.data->key;
-
-                expr_t *instance = Substitute(ax, A, B, C);
-                
-                if (FindExprInTerms(instance) == NULL) {
-                    true_expr_t te;
-                    TrueExpr_Init(&te, instance);
-                    TrueExpr_Axiom(&te, ax, A, B, C);
-                    AddToPool(&te);
-                    if (print_axioms) PrintAxiom(&te);
-                }
-                else {
-                    Expr_Free(instance);
-                }
-            }
+    batch_t *batch = arg;
+    long slice = batch_slice > 0 ? batch_slice : LONG_MAX;
+    Writer_Init(&out, -1);
+
+    pthread_mutex_lock(&batch->lock);
+    for (;;) {
+        int i;
+        prover_ctx_t *ctx = NULL;
+        bool admit = false;
+
+        if (batch->next < batch->count && batch->in_flight < batch->max_in_flight) {
+            i = batch->next++;
+            batch->in_flight++;
+            if (batch->spare_count > 0) ctx = batch->spare[--batch->spare_count];
+            admit = true;
         }
-    }
-}
+        else if (batch->ready_count > 0) {
+            i = batch->ready[batch->ready_head];
+            batch->ready_head = (batch->ready_head + 1) % batch->max_in_flight;
+            batch->ready_count--;
+        }
+        else if (batch->next >= batch->count && batch->in_flight == 0) {
+            break;
+        }
+        else {
+            pthread_cond_wait(&batch->runnable, &batch->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&batch->lock);
+
+        batch_job_t *job = &batch->jobs[i];
+        const char *expected = admit ? Parser_Check(job->begin, job->end) : NULL;
+        prover_status_t status;
+        if (expected != NULL) {
+            job->ctx = ctx;
+            Writer_Init(&job->record, -1);
+            Prover_WriteErrorRecord(&job->record, i + 1, expected);
+            status = PROVER_NOT_FOUND;
+        }
+        else if (admit) {
+            job->ctx = ctx != NULL ? ctx : Prover_CreateShared(batch->root);
+            Writer_Init(&job->record, -1);
+            Prover_SetGoal(job->ctx, job->begin, job->end);
+            status = Prover_Start(job->ctx);
+        }
+        else {
+            status = Prover_Step(job->ctx, slice);
+        }
+        BatchCollect(job);
 
-terms_set assumptions;
+        if (status == PROVER_RUNNING) {
+            pthread_mutex_lock(&batch->lock);
+            int tail = (batch->ready_head + batch->ready_count++) % batch->max_in_flight;
+            batch->ready[tail] = i;
+            pthread_cond_signal(&batch->runnable);
+            continue;
+        }
 
-bool ProveWithAssumptions(expr_t* goal, terms_set* temp_assumptions, int depth);
+        if (expected == NULL) {
+            Prover_WriteRecord(job->ctx, &job->record, i + 1, print_history == 1);
+            Prover_Reset(job->ctx);
+        }
 
-bool TryDeduction(expr_t* A)
-{
-    terms_set local_assumptions;
-    terms_set_init(&local_assumptions);
+        pthread_mutex_lock(&batch->lock);
+        if (job->ctx != NULL) batch->spare[batch->spare_count++] = job->ctx;
+        job->ctx = NULL;
+        job->found = status == PROVER_FOUND;
+        job->done = true;
+        batch->in_flight--;
+        pthread_cond_broadcast(&batch->done);
+        pthread_cond_broadcast(&batch->runnable);
+    }
+    pthread_mutex_unlock(&batch->lock);
 
-    bool result = ProveWithAssumptions(A, &local_assumptions, 0);
-    
-    terms_set_clear(&local_assumptions);
-    return result;
+    Writer_Free(&out);
+    return NULL;
 }
 
-#define DEPTH for (int i = 0; i < depth; i++) printf("  ");
-
-bool ProveWithAssumptions(expr_t* goal, terms_set* temp_assumptions, int depth)
+static int BatchParallel(prover_ctx_t *root, source_t *input)
 {
-    if (depth > 50) {
-        return false;
+    batch_t batch;
+    memset(&batch, 0, sizeof(batch));
+    batch.root = root;
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_cond_init(&batch.runnable, NULL);
+    pthread_cond_init(&batch.done, NULL);
+
+    int capacity = 0;
+    const char *begin, *end;
+    while (Source_NextLine(input, &begin, &end)) {
+        if (Source_SkipLine(begin, end)) {
+            continue;
+        }
+        if (batch.count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            batch.jobs = realloc(batch.jobs, capacity * sizeof(batch_job_t));
+            if (batch.jobs == NULL) {
+                fprintf(stderr, "Out of memory\n");
+                exit(1);
+            }
+        }
+        batch.jobs[batch.count++] = (batch_job_t){ .begin = begin, .end = end };
     }
 
-    //DEPTH printf("Prove "); Expr_Print(goal); printf("\n");
-    
-    if (FindExprInPool(goal) != NULL) {
-        //DEPTH printf("OK! (Already proven)\n");
-        return true;
+    /* Without slices a goal runs to the end once started, so one per thread. */
+    batch.max_in_flight = batch_slice > 0 ? BATCH_IN_FLIGHT : batch_threads;
+    batch.ready = malloc(batch.max_in_flight * sizeof(int));
+    batch.spare = malloc(batch.max_in_flight * sizeof(prover_ctx_t *));
+    if (batch.ready == NULL || batch.spare == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
     }
 
-    terms_set_itr it_assume = terms_set_get(temp_assumptions, goal);
-    if (!terms_set_is_end(it_assume)) {
-        //DEPTH printf("OK! (assumed)\n");
-        return true;
+    int threads = batch_threads < batch.count ? batch_threads : batch.count;
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    int started = 0;
+    while (started < threads && pthread_create(&tids[started], NULL, BatchWorker, &batch) == 0) {
+        started++;
+    }
+    if (started == 0 && batch.count > 0) {
+        fprintf(stderr, "failed to start batch threads\n");
+        exit(1);
     }
 
-    for (pool_map_itr it = pool_map_first(&pool); !pool_map_is_end(it); it = pool_map_next(it)) {
-        true_expr_t *te = &it.data->val;
-        expr_t *e = te->e;
+    int failed = 0;
+    for (int i = 0; i < batch.count; i++) {
+        batch_job_t *job = &batch.jobs[i];
 
-        if (te->visited) continue;
+        pthread_mutex_lock(&batch.lock);
+        while (!job->done) pthread_cond_wait(&batch.done, &batch.lock);
+        pthread_mutex_unlock(&batch.lock);
 
-        if (e->type == EXPR_IMPLIES && Expr_Equal(e->implies.b, goal)) {
-            te->visited = true;
-            bool ok = ProveWithAssumptions(e->implies.a, temp_assumptions, depth+1);
-            te->visited = false;
-            if (ok) {
-                //DEPTH printf("OK! (found X => goal, proved X)\n");
-                return true;    
-            }
-        }
+        Writer_Put(&out, job->record.buf, job->record.len);
+        Writer_Flush(&out);
+        failed |= !job->found;
+        Writer_Free(&job->record);
     }
 
-    // A => B
-    if (goal->type == EXPR_IMPLIES) {
-        expr_t* A = goal->implies.a;
-        expr_t* B = goal->implies.b;
-        
-        bool ok = false;
-        if (terms_set_is_end(terms_set_get(temp_assumptions, A))) {
-            //DEPTH printf("Assume "); Expr_Print(A); printf("\n");
-            terms_set_insert(temp_assumptions, A);
-            ok = ProveWithAssumptions(B, temp_assumptions, depth+1);
-            terms_set_erase(temp_assumptions, A);
-        }
-        else ok = ProveWithAssumptions(B, temp_assumptions, depth+1);
-
-        if (ok) {
-            //DEPTH printf("OK! (assume A, prove B)\n");
-            return true;
-        }
+    for (int t = 0; t < started; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    for (int k = 0; k < batch.spare_count; k++) {
+        Stats_Merge(&batch_stats, &batch.spare[k]->stats);
+        Prover_Destroy(batch.spare[k]);
     }
 
-    return false;
+    free(tids);
+    free(batch.spare);
+    free(batch.ready);
+    free(batch.jobs);
+    pthread_cond_destroy(&batch.done);
+    pthread_cond_destroy(&batch.runnable);
+    pthread_mutex_destroy(&batch.lock);
+    return failed;
 }
 
-true_expr_t *RunInference(expr_t* goal)
+/*
+ * Proves every goal read from stdin, one per line, and writes a record per
+ * goal; a line that does not parse gets a GOAL n ERROR record, as with
+ * +serve. Blank lines and lines starting with '#' are skipped. Expressions
+ * built for a goal are released before the next one, so only the axioms,
+ * schemas and interned atoms carry over. With +threads=N the goals are
+ * spread over N workers, and with +slice=N each goal runs for N steps at a
+ * time before yielding to the others, so easy goals are not stuck behind
+ * hard ones; records still come out in input order.
+ */
+int BatchMain(prover_ctx_t *ctx)
 {
-    int cycle = 0;
-    int new_found = 1;
-    int goal_found = 0;
-
-    while (new_found != 0 && !goal_found && cycle < 2) {
-        new_found = 0;
-        cycle++;
-        
-        for (pool_map_itr it = pool_map_first(&pool); !pool_map_is_end(it) && !goal_found;) {
-            expr_t *A_impl_B = it.data->val.e;
-            
-            if (A_impl_B->type != EXPR_IMPLIES) {
-                continue;
-            }
-            expr_t *A = A_impl_B->implies.a;
-            expr_t *B = A_impl_B->implies.b;
-            
-            if (FindExprInPool(B) != NULL) {
-                it = pool_map_next(it);
-                continue;
-            }
+    source_t input;
+    if (Source_OpenFd(&input, 0) != 0) return 1;
 
-            true_expr_t *A_te = FindExprInPool(A);
-            //if (A_te == NULL) {
-            //    bool res = TryDeduction(A);
-            //    if (res) {
-            //        printf("DEDUCTED "); Expr_Print(A); printf("\n");
-            //        true_expr_t te;
-            //        TrueExpr_Init(&te, B);
-            //        TrueExpr_Deduction(&te);
-            //        AddToPool(&te); // iterator gets invalidated.... :(((
-            //        it = pool_map_first(&pool);
-            //        new_found = 1;
-            //        continue;
-            //    }
-            //}
-            
-            if (A_te != NULL) {
-                true_expr_t te;
-                TrueExpr_Init(&te, B);
-                TrueExpr_ModusPonens(&te, A_impl_B, A);
-                AddToPool(&te); // iterator gets invalidated.... :(((
-                it = pool_map_first(&pool);
-                new_found = 1;
-                
-                if (Expr_Equal(B, goal)) {
-                    printf("GOAL FOUND!\n");
-                    goal_found = 1;
-                }
-                continue;
-            }
+    if (batch_threads > 1 || batch_slice > 0) {
+        int failed = BatchParallel(ctx, &input);
+        Source_Close(&input);
+        return failed;
+    }
+
+    int failed = 0;
+    int n = 0;
 
-            it = pool_map_next(it);
+    const char *begin, *end;
+    while (Source_NextLine(&input, &begin, &end)) {
+        if (Source_SkipLine(begin, end)) {
+            continue;
         }
+
+        failed |= !BatchGoal(ctx, ++n, begin, end);
+        Writer_Flush(&out);
     }
 
-    return FindExprInPool(goal); 
+    Source_Close(&input);
+    return failed;
 }
 
-void PrintHistory(true_expr_t *te)
+/* A budget is a whole non-negative number; 0 means no limit. */
+static bool ParseBudget(const char *s, long *value)
 {
-    if (te->printed) return;
-    te->printed = 1;
-
-    switch (te->type) {
-    case INFERENCE_AXIOM:
-        PrintAxiom(te);
-        break;
-    case INFERENCE_MODUS_PONENS:
-        PrintHistory(FindExprInPool(te->modus_ponens.A));
-        PrintHistory(FindExprInPool(te->modus_ponens.A_impl_B));
-        PrintModusPonens(te);
-        break;
-    case INFERENCE_DEDUCTION:
-        printf("%5d DEDUCTED ", te->idx);
-        Expr_Print(te->e);
-        printf("\n");
-        break;
-    }
+    char *end;
+    errno = 0;
+    long v = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || errno != 0 || v < 0) return false;
+
+    *value = v;
+    return true;
 }
 
 int main(int argc, char **argv) {
@@ -412,71 +367,161 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    pool_map_init(&pool);
-    terms_set_init(&terms);
-    terms_set_init(&assumptions);
+    if (strcmp(*argv, "--check") == 0) {
+        return CheckMain(argv + 1);
+    }
 
     char *filename = *argv;
     argv++;
-    
+
+    Prover_DefaultOptions(&options);
     while (*argv != NULL) {
-        if (strcmp(*argv, "+axioms") == 0) print_axioms = 1;
-        else if (strcmp(*argv, "-axioms") == 0) print_axioms = 0;
+        if (strcmp(*argv, "+axioms") == 0) options.print_axioms = 1;
+        else if (strcmp(*argv, "-axioms") == 0) options.print_axioms = 0;
         else if (strcmp(*argv, "+history") == 0) print_history = 1;
         else if (strcmp(*argv, "-history") == 0) print_history = 0;
-        else if (strcmp(*argv, "+neg") == 0) add_neg_terms = 1;
-        else if (strcmp(*argv, "-neg") == 0) add_neg_terms = 0;
-        else if (strcmp(*argv, "+self_impl") == 0) add_self_impl = 1;
-        else if (strcmp(*argv, "-self_impl") == 0) add_self_impl = 0;
+        else if (strcmp(*argv, "+neg") == 0) options.add_neg_terms = 1;
+        else if (strcmp(*argv, "-neg") == 0) options.add_neg_terms = 0;
+        else if (strcmp(*argv, "+self_impl") == 0) options.add_self_impl = 1;
+        else if (strcmp(*argv, "-self_impl") == 0) options.add_self_impl = 0;
+        else if (strcmp(*argv, "+shortest") == 0) options.shortest_proof = 1;
+        else if (strcmp(*argv, "+shortest=size") == 0) options.shortest_proof = 1, options.proof_metric = PROOF_METRIC_SIZE;
+        else if (strcmp(*argv, "+shortest=depth") == 0) options.shortest_proof = 1, options.proof_metric = PROOF_METRIC_DEPTH;
+        else if (strcmp(*argv, "-shortest") == 0) options.shortest_proof = 0;
+        else if (strcmp(*argv, "+schemas") == 0) options.derive_schemas = 1;
+        else if (strcmp(*argv, "-schemas") == 0) options.derive_schemas = 0;
+        else if (strcmp(*argv, "+batch") == 0) batch_mode = 1;
+        else if (strcmp(*argv, "-batch") == 0) batch_mode = 0;
+        else if (strncmp(*argv, "+threads=", 9) == 0) {
+            long threads;
+            if (!ParseBudget(*argv + 9, &threads) || threads < 1 || threads > INT_MAX) {
+                printf("bad thread count in %s\n", *argv);
+                return 1;
+            }
+            batch_threads = (int)threads;
+        }
+        else if (strncmp(*argv, "+slice=", 7) == 0) {
+            if (!ParseBudget(*argv + 7, &batch_slice) || batch_slice < 1) {
+                printf("bad slice length in %s\n", *argv);
+                return 1;
+            }
+        }
+        else if (strcmp(*argv, "+rules") == 0) options.enabled_rules = RULES_ALL;
+        else if (strcmp(*argv, "-rules") == 0) options.enabled_rules = 0;
+        else if (strncmp(*argv, "+rules=", 7) == 0) {
+            if (Rules_Parse(*argv + 7, &options.enabled_rules) != 0) {
+                printf("unknown rule in %s\n", *argv);
+                return 1;
+            }
+        }
+        else if (strncmp(*argv, "+proof-bin=", 11) == 0) proof_bin_path = *argv + 11;
+        else if (strncmp(*argv, "+lemma-db=", 10) == 0) options.lemma_db_path = *argv + 10;
+        else if (strncmp(*argv, "+save-pool=", 11) == 0) options.save_pool_path = *argv + 11;
+        else if (strncmp(*argv, "+load-pool=", 11) == 0) options.load_pool_path = *argv + 11;
+        else if (strncmp(*argv, "+serve=", 7) == 0) serve_path = *argv + 7;
+        else if (strcmp(*argv, "+portfolio") == 0) portfolio = 1;
+        else if (strcmp(*argv, "+stats") == 0) stats_mode = 1;
+        else if (strcmp(*argv, "+stats=json") == 0) stats_mode = 2;
+        else if (strcmp(*argv, "-stats") == 0) stats_mode = 0;
+        else if (strncmp(*argv, "+max-time=", 10) == 0) {
+            if (!ParseBudget(*argv + 10, &options.max_time_ms)) {
+                printf("bad limit in %s\n", *argv);
+                return 1;
+            }
+        }
+        else if (strncmp(*argv, "+max-exprs=", 11) == 0) {
+            if (!ParseBudget(*argv + 11, &options.max_exprs)) {
+                printf("bad limit in %s\n", *argv);
+                return 1;
+            }
+        }
+        else if (strncmp(*argv, "+max-pool=", 10) == 0) {
+            if (!ParseBudget(*argv + 10, &options.max_pool)) {
+                printf("bad limit in %s\n", *argv);
+                return 1;
+            }
+        }
+        else if (strncmp(*argv, "+trace=", 7) == 0) trace_path = *argv + 7;
+        else if (strncmp(*argv, "+trace-min=", 11) == 0) {
+            if (!ParseBudget(*argv + 11, &trace_min_us)) {
+                printf("bad duration in %s\n", *argv);
+                return 1;
+            }
+        }
+        else if (strcmp(*argv, "-portfolio") == 0) portfolio = 0;
         argv++;
     }
 
-    static char buffer[1024];
-    if(!fgets(buffer, sizeof(buffer), stdin)) return 1;
-    
-    parser_t parser;
-    Parser_Init(&parser, buffer);
-    expr_t *goal = Parser_ReadExpr(&parser);
-
-    
-    ExtractSubformulas(goal, 0);
-    if (add_neg_terms) ExtractSubformulas(goal, 1);
+    /* The server writes the same records as batch mode. */
+    if (serve_path != NULL) batch_mode = 1;
 
-    if (add_self_impl) {
-        expr_t* self_impl = Expr_Implies(goal, goal);
-        AddTerm(self_impl);
+    options.announce = !batch_mode;
+    if (print_history < 0) print_history = !batch_mode;
+    if (batch_mode && proof_bin_path != NULL) {
+        fprintf(stderr, "+proof-bin is ignored in batch mode\n");
+        proof_bin_path = NULL;
+    }
+    if (serve_path != NULL && stats_mode) {
+        fprintf(stderr, "+stats is ignored with +serve\n");
+        stats_mode = 0;
     }
+    if (batch_mode && portfolio) {
+        fprintf(stderr, "+portfolio is ignored in batch mode\n");
+        portfolio = 0;
+    }
+
+    if (trace_path != NULL && Trace_Open(trace_path, trace_min_us) != 0) return 1;
+    Stats_CatchSignal(SIGUSR1);
+
+    Writer_Init(&out, 1);
+    prover_ctx_t *ctx = Prover_Create(&options);
+
+    source_t input;
+    const char *begin = NULL, *end = NULL;
+    if (!batch_mode) {
+        if (Source_OpenFd(&input, 0) != 0) return 1;
+        if (!Source_NextLine(&input, &begin, &end)) return 1;
 
-    printf("TERMS:\n");
-    for (terms_set_itr it = terms_set_first(&terms); !terms_set_is_end(it); it = terms_set_next(it)) {
-        printf("    "); Expr_Print(it.data->key); printf("\n");
+        Prover_SetGoal(ctx, begin, end);
+        Prover_PrintTerms(ctx, &out);
+        Writer_Flush(&out);
     }
-    printf("\n");
 
-    FILE *fptr = fopen(filename, "r");
-    if (fptr == NULL) {
-        printf("failed to open file");
+    if (Prover_LoadAxioms(ctx, filename) < 0) {
+        Writer_Str(&out, "failed to open file");
+        Prover_Destroy(ctx);
+        Writer_Free(&out);
         return 1;
     }
 
-    while (1) {
-        static char line[128];
-        char *res = fgets(line, sizeof(line), fptr);
-        
-        if (res == NULL) break;
-        if (line[0] == '#') {
-            continue;
-        }
-        
-        Parser_Init(&parser, line);
-        expr_t *ax = Parser_ReadExpr(&parser);
-        InstantiateAxiom(ax);
+    int failed;
+    if (serve_path != NULL) {
+        failed = Server_Run(ctx, serve_path, print_history == 1, batch_slice);
+    }
+    else if (batch_mode) {
+        failed = BatchMain(ctx);
+    }
+    else if (portfolio) {
+        failed = PortfolioMain(ctx, begin, end);
+    }
+    else {
+        failed = !Prover_Prove(ctx);
+        if (!failed) failed = EmitProof(Prover_Proof(ctx));
+        else Prover_WritePartial(ctx, &out);
     }
 
-    fclose(fptr);
-
-    true_expr_t *res = RunInference(goal);
-    if (res != NULL && print_history) PrintHistory(res);
-
-    return !res;
-}
\ No newline at end of file
+    if (!batch_mode) Source_Close(&input);
+    if (stats_mode) {
+        writer_t err;
+        Writer_Init(&err, 2);
+        Stats_Merge(&batch_stats, &ctx->stats);
+        Prover_WriteStats(ctx, &batch_stats, &err, stats_mode == 2);
+        Writer_Free(&err);
+        Stats_Free(&batch_stats);
+    }
+    if (Prover_WriteFailed(ctx)) failed = 1;
+    Prover_Destroy(ctx);
+    Trace_Close();
+    if (Writer_Free(&out) != 0) failed = 1;
+    return failed;
+}
@@ -7,94 +7,219 @@
 
 static void Parser_ReadToken(parser_t *parser)
 {
-    while (isspace(parser->cur_char[0])) {
-        parser->cur_char++;
+    const char *c = parser->cur_char;
+    const char *end = parser->end;
+
+    while (c < end && isspace((unsigned char)*c)) {
+        c++;
     }
 
     token_t *tok = &parser->cur_token;
+    tok->start = c;
+    tok->len = 0;
+
+    if (c == end || *c == '\0') {
+        tok->type = TOK_EOF;
+        parser->cur_char = c;
+        return;
+    }
 
-    switch (parser->cur_char[0]) {
-    case '!': tok->type = TOK_NOT; parser->cur_char++; return;
-    case '(': tok->type = TOK_LPAREN; parser->cur_char++; return;
-    case ')': tok->type = TOK_RPAREN; parser->cur_char++; return;
+    switch (*c) {
+    case '!': tok->type = TOK_NOT; parser->cur_char = c + 1; return;
+    case '(': tok->type = TOK_LPAREN; parser->cur_char = c + 1; return;
+    case ')': tok->type = TOK_RPAREN; parser->cur_char = c + 1; return;
     case '=':
-        if (parser->cur_char[1] == '>') {
+        if (c + 1 < end && c[1] == '>') {
             tok->type = TOK_IMPLIES;
-            parser->cur_char += 2;
-            return;
+            parser->cur_char = c + 2;
         }
         else {
             tok->type = TOK_ERR;
-            parser->cur_char++;
-            return;
+            parser->cur_char = c + 1;
         }
-        break;
-    case '\0': tok->type = TOK_EOF; return;
+        return;
     default:
         break;
     }
 
-    if (!isalpha(parser->cur_char[0])) {
+    if (!isalpha((unsigned char)*c)) {
         tok->type = TOK_ERR;
-        parser->cur_char++;
+        parser->cur_char = c + 1;
         return;
     }
 
     tok->type = TOK_ATOM;
-
-    int len = 0;
-    while (isalpha(parser->cur_char[0])) {
-        tok->name[len] = parser->cur_char[0];
-        len++;
-        parser->cur_char++;
+    while (c < end && isalpha((unsigned char)*c)) {
+        c++;
     }
-    tok->name[len] = '\0';
+    tok->len = c - tok->start;
+    parser->cur_char = c;
 }
 
-void Parser_Init(parser_t *parser, const char *input)
+void Parser_InitRange(parser_t *parser, const char *begin, const char *end)
 {
-    parser->cur_char = input;
+    parser->cur_char = begin;
+    parser->end = end;
     Parser_ReadToken(parser);
 }
 
+void Parser_Init(parser_t *parser, const char *input)
+{
+    Parser_InitRange(parser, input, input + strlen(input));
+}
+
+static void Parser_Expected(const char *what, token_t *tok)
+{
+    printf("Expected %s, got ", what);
+    Token_Print(tok);
+    printf("\n");
+    raise(SIGTRAP);
+}
+
+typedef enum {
+    PENDING_NOT,
+    PENDING_LEFT,
+    PENDING_RIGHT
+} pending_t;
+
+typedef struct {
+    pending_t state;
+    expr_t *left;
+} parse_frame_t;
+
+/*
+ * Shift-reduce over an explicit stack of unfinished '!' and '(' nodes,
+ * so nesting depth is bounded by memory rather than the C stack.
+ */
 expr_t *Parser_ReadExpr(parser_t *parser)
 {
     token_t *tok = &parser->cur_token;
-    
-    if (tok->type == TOK_NOT) {
-        Parser_ReadToken(parser);
-        return Expr_Not(Parser_ReadExpr(parser));
-    }
-    if (tok->type == TOK_ATOM) {
-        char name[16];
-        strcpy(name, tok->name);
-        Parser_ReadToken(parser);
-        return Expr_Atom(name);
-    }
-    if (tok->type == TOK_LPAREN) {
-        Parser_ReadToken(parser);
-        expr_t *left = Parser_ReadExpr(parser);
-        if (parser->cur_token.type != TOK_IMPLIES) {
-            printf("Expected '=>', got ");
-            Token_Print(tok);
-            printf("\n");
-            raise(SIGTRAP);
+
+    parse_frame_t local[64];
+    parse_frame_t *stack = local;
+    int sp = 0, cap = 64;
+
+    while (1) {
+        if (sp + 1 > cap) stack = Expr_GrowStack(stack, local, &cap, sizeof(parse_frame_t));
+
+        if (tok->type == TOK_NOT) {
+            stack[sp++] = (parse_frame_t){ PENDING_NOT, NULL };
+            Parser_ReadToken(parser);
+            continue;
         }
-        Parser_ReadToken(parser);
-        expr_t *right = Parser_ReadExpr(parser);
-        if (parser->cur_token.type != TOK_RPAREN) {
-            printf("Expected ')', got ");
+        if (tok->type == TOK_LPAREN) {
+            stack[sp++] = (parse_frame_t){ PENDING_LEFT, NULL };
+            Parser_ReadToken(parser);
+            continue;
+        }
+        if (tok->type != TOK_ATOM) {
+            Parser_Expected("'!', '(', or atom", tok);
+            break;
+        }
+
+        expr_t *e = Expr_InternAtom(tok->start, tok->len);
+        if (e == NULL) {
+            printf("Atom name too long: ");
             Token_Print(tok);
             printf("\n");
             raise(SIGTRAP);
         }
         Parser_ReadToken(parser);
-        return Expr_Implies(left, right);
+
+        while (sp > 0) {
+            parse_frame_t *f = &stack[sp - 1];
+            if (f->state == PENDING_NOT) {
+                e = Expr_Not(e);
+                sp--;
+            }
+            else if (f->state == PENDING_LEFT) {
+                if (tok->type != TOK_IMPLIES) Parser_Expected("'=>'", tok);
+                Parser_ReadToken(parser);
+                f->left = e;
+                f->state = PENDING_RIGHT;
+                break;
+            }
+            else {
+                if (tok->type != TOK_RPAREN) Parser_Expected("')'", tok);
+                Parser_ReadToken(parser);
+                e = Expr_Implies(f->left, e);
+                sp--;
+            }
+        }
+
+        if (sp == 0) {
+            if (stack != local) free(stack);
+            return e;
+        }
     }
 
-    printf("Expected '!', '(', or atom, got ");
-    Token_Print(tok);
-    printf("\n");
-    raise(SIGTRAP);
+    if (stack != local) free(stack);
     return NULL;
 }
+
+/*
+ * Checks the formula on [begin, end) without building it. Returns NULL if
+ * Parser_ReadExpr accepts it and it nests at most PARSER_MAX_DEPTH deep,
+ * otherwise what was expected. Callers that must survive bad input (the
+ * server) check it first, since the parser itself traps.
+ */
+const char *Parser_Check(const char *begin, const char *end)
+{
+    parser_t parser;
+    Parser_InitRange(&parser, begin, end);
+    token_t *tok = &parser.cur_token;
+
+    pending_t local[64];
+    pending_t *stack = local;
+    int sp = 0, cap = 64;
+    const char *err = NULL;
+
+    while (err == NULL) {
+        if (sp + 1 > cap) stack = Expr_GrowStack(stack, local, &cap, sizeof(pending_t));
+
+        if ((tok->type == TOK_NOT || tok->type == TOK_LPAREN) && sp == PARSER_MAX_DEPTH) {
+            err = "fewer nested connectives";
+            break;
+        }
+        if (tok->type == TOK_NOT) {
+            stack[sp++] = PENDING_NOT;
+            Parser_ReadToken(&parser);
+            continue;
+        }
+        if (tok->type == TOK_LPAREN) {
+            stack[sp++] = PENDING_LEFT;
+            Parser_ReadToken(&parser);
+            continue;
+        }
+        if (tok->type != TOK_ATOM) {
+            err = "'!', '(', or atom";
+            break;
+        }
+        if (tok->len >= (int)sizeof(((expr_t *)0)->atom.name)) {
+            err = "a shorter atom name";
+            break;
+        }
+        Parser_ReadToken(&parser);
+
+        while (sp > 0 && err == NULL) {
+            if (stack[sp - 1] == PENDING_NOT) {
+                sp--;
+                continue;
+            }
+            if (stack[sp - 1] == PENDING_LEFT) {
+                if (tok->type != TOK_IMPLIES) err = "'=>'";
+                Parser_ReadToken(&parser);
+                stack[sp - 1] = PENDING_RIGHT;
+                break;
+            }
+            if (tok->type != TOK_RPAREN) err = "')'";
+            Parser_ReadToken(&parser);
+            sp--;
+        }
+
+        if (sp == 0) break;
+    }
+
+    if (stack != local) free(stack);
+    return err;
+}
@@ -4,12 +4,27 @@
 #include "token.h"
 #include "expr.h"
 
+/*
+ * Parses formulas in place from [cur_char, end), e.g. a line of a mapped
+ * file; the input is never copied and need not be NUL-terminated. Atoms
+ * are interned (see Expr_InternAtom).
+ */
 typedef struct {
     token_t cur_token;
     const char *cur_char;
+    const char *end;
 } parser_t;
 
+/*
+ * Deepest nesting of '!' and '(' that Parser_Check accepts. Walks over
+ * formulas are not limited by the C stack, but a deeper line from a
+ * client or a batch would mostly fill the arena with its terms.
+ */
+#define PARSER_MAX_DEPTH 100000
+
 void Parser_Init(parser_t *parser, const char *input);
+void Parser_InitRange(parser_t *parser, const char *begin, const char *end);
 expr_t *Parser_ReadExpr(parser_t *parser);
+const char *Parser_Check(const char *begin, const char *end);
 
 #endif
@@ -0,0 +1,282 @@
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+_Thread_local pool_map pool;
+_Thread_local terms_set terms;
+_Thread_local bool pool_record_derivations = false;
+
+#define DERIVATION_BLOCK 4096
+#define COST_INF UINT64_MAX
+
+static _Thread_local derivation_t **derivation_blocks = NULL;
+static _Thread_local int derivation_block_count = 0;
+static _Thread_local int derivation_idx = DERIVATION_BLOCK;
+
+static derivation_t *AllocDerivation()
+{
+    if (derivation_idx == DERIVATION_BLOCK) {
+        derivation_blocks = realloc(derivation_blocks, (derivation_block_count + 1) * sizeof(derivation_t *));
+        derivation_t *block = malloc(DERIVATION_BLOCK * sizeof(derivation_t));
+        if (derivation_blocks == NULL || block == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+        derivation_blocks[derivation_block_count++] = block;
+        derivation_idx = 0;
+    }
+    return derivation_blocks[derivation_block_count - 1] + derivation_idx++;
+}
+
+/* Empties the pool and the term set for the next goal; their buckets are kept. */
+void Pool_Reset(void)
+{
+    pool_map_clear(&pool);
+    terms_set_clear(&terms);
+
+    for (int i = 0; i < derivation_block_count; i++) {
+        free(derivation_blocks[i]);
+    }
+    free(derivation_blocks);
+    derivation_blocks = NULL;
+    derivation_block_count = 0;
+    derivation_idx = DERIVATION_BLOCK;
+}
+
+void Pool_InitState(pool_state_t *st, bool record_derivations)
+{
+    pool_map_init(&st->pool);
+    terms_set_init(&st->terms);
+    st->derivation_blocks = NULL;
+    st->derivation_block_count = 0;
+    st->derivation_idx = DERIVATION_BLOCK;
+    st->record_derivations = record_derivations;
+}
+
+void Pool_FreeState(pool_state_t *st)
+{
+    for (int i = 0; i < st->derivation_block_count; i++) {
+        free(st->derivation_blocks[i]);
+    }
+    free(st->derivation_blocks);
+    pool_map_cleanup(&st->pool);
+    terms_set_cleanup(&st->terms);
+}
+
+#define SWAP(type, a, b) do { type tmp_ = (a); (a) = (b); (b) = tmp_; } while (0)
+
+/* Exchanges the calling thread's pool state with st. */
+void Pool_Swap(pool_state_t *st)
+{
+    SWAP(pool_map, pool, st->pool);
+    SWAP(terms_set, terms, st->terms);
+    SWAP(derivation_t **, derivation_blocks, st->derivation_blocks);
+    SWAP(int, derivation_block_count, st->derivation_block_count);
+    SWAP(int, derivation_idx, st->derivation_idx);
+    SWAP(bool, pool_record_derivations, st->record_derivations);
+}
+
+true_expr_t *FindExprInPool(expr_t *e)
+{
+    pool_map_itr iter = pool_map_get(&pool, e);
+    if (pool_map_is_end(iter)) {
+        return NULL;
+    }
+    return &iter.data->val;
+}
+
+expr_t *FindExprInTerms(expr_t *e)
+{
+    terms_set_itr iter = terms_set_get(&terms, e);
+    if (terms_set_is_end(iter)) {
+        return NULL;
+    }
+    return iter.data->key;
+}
+
+void TrueExpr_Init(true_expr_t *te, expr_t *e)
+{
+    te->e = e;
+    te->idx = pool_map_size(&pool);
+    te->alt = NULL;
+    te->cost = COST_INF;
+    te->mp_recorded = false;
+}
+
+static void Derivation_Load(derivation_t *d, true_expr_t *te)
+{
+    d->type = te->type;
+    if (te->type == INFERENCE_AXIOM) d->axiom = te->axiom;
+    else if (te->type == INFERENCE_MODUS_PONENS) d->modus_ponens = te->modus_ponens;
+    else if (te->type == INFERENCE_RULE) d->rule = te->rule;
+}
+
+static void Derivation_Store(true_expr_t *te, derivation_t *d)
+{
+    te->type = d->type;
+    if (d->type == INFERENCE_AXIOM) te->axiom = d->axiom;
+    else if (d->type == INFERENCE_MODUS_PONENS) te->modus_ponens = d->modus_ponens;
+    else if (d->type == INFERENCE_RULE) te->rule = d->rule;
+}
+
+static void Derivation_Swap(true_expr_t *te, derivation_t *d)
+{
+    derivation_t tmp;
+    Derivation_Load(&tmp, te);
+    Derivation_Store(te, d);
+    tmp.next = d->next;
+    *d = tmp;
+}
+
+static bool HasAxiomDerivation(true_expr_t *te)
+{
+    if (te->type == INFERENCE_AXIOM) return true;
+    for (derivation_t *d = te->alt; d != NULL; d = d->next) {
+        if (d->type == INFERENCE_AXIOM) return true;
+    }
+    return false;
+}
+
+/*
+ * Records the justification of `other` as another way to derive te->e.
+ * All axiom instances cost one step, so a single one is enough.
+ */
+void AddAlternative(true_expr_t *te, true_expr_t *other)
+{
+    if (other->type == INFERENCE_AXIOM && HasAxiomDerivation(te)) {
+        return;
+    }
+
+    derivation_t *d = AllocDerivation();
+    Derivation_Load(d, other);
+    d->next = te->alt;
+    te->alt = d;
+}
+
+void AddToPool(true_expr_t* te)
+{
+    if (!pool_record_derivations) {
+        pool_map_insert(&pool, te->e, *te);
+        return;
+    }
+
+    size_t size = pool_map_size(&pool);
+    pool_map_itr iter = pool_map_get_or_insert(&pool, te->e, *te);
+    if (pool_map_size(&pool) == size) {
+        AddAlternative(&iter.data->val, te);
+    }
+}
+
+static uint64_t PremiseCost(expr_t *e)
+{
+    true_expr_t *te = FindExprInPool(e);
+    return te != NULL ? te->cost : COST_INF;
+}
+
+/*
+ * A rule step is charged the full length of its expansion under either
+ * metric, which bounds the depth it adds from above.
+ */
+static uint64_t DerivationCost(derivation_t *d, proof_metric_t metric)
+{
+    uint64_t a, b, steps = 1;
+    if (d->type == INFERENCE_MODUS_PONENS) {
+        a = PremiseCost(d->modus_ponens.A_impl_B);
+        b = PremiseCost(d->modus_ponens.A);
+    }
+    else if (d->type == INFERENCE_RULE) {
+        a = PremiseCost(d->rule.premises[0]);
+        b = d->rule.premises[1] != NULL ? PremiseCost(d->rule.premises[1]) : 0;
+        steps = d->rule.steps;
+    }
+    else {
+        return 1;
+    }
+
+    if (a == COST_INF || b == COST_INF) {
+        return COST_INF;
+    }
+
+    if (metric == PROOF_METRIC_DEPTH) {
+        return steps + (a > b ? a : b);
+    }
+    return a + b >= COST_INF - steps ? COST_INF - 1 : a + b + steps;
+}
+
+/*
+ * Bellman-Ford style relaxation over every recorded derivation: the cost of
+ * a formula is the cheapest of its derivations, where an MP step costs one
+ * plus its premises (summed for proof size, maxed for depth). Summing counts
+ * shared lemmas once per use, so the size metric is the tree size of the
+ * proof, an upper bound on the printed DAG. The cheapest derivation is moved
+ * into the entry itself, so Proof_Extract picks it up unchanged. Premises of
+ * a chosen step are strictly cheaper than the step, so the result is acyclic.
+ */
+void Pool_SelectCheapest(proof_metric_t metric)
+{
+    for (pool_map_itr it = pool_map_first(&pool); !pool_map_is_end(it); it = pool_map_next(it)) {
+        true_expr_t *te = &it.data->val;
+        te->cost = COST_INF;
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (pool_map_itr it = pool_map_first(&pool); !pool_map_is_end(it); it = pool_map_next(it)) {
+            true_expr_t *te = &it.data->val;
+
+            derivation_t cur;
+            Derivation_Load(&cur, te);
+            uint64_t cost = DerivationCost(&cur, metric);
+            if (cost < te->cost) {
+                te->cost = cost;
+                changed = true;
+            }
+
+            for (derivation_t *d = te->alt; d != NULL; d = d->next) {
+                cost = DerivationCost(d, metric);
+                if (cost < te->cost) {
+                    te->cost = cost;
+                    Derivation_Swap(te, d);
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+void TrueExpr_ModusPonens(true_expr_t *te, expr_t *A_impl_B, expr_t *A)
+{
+    te->type = INFERENCE_MODUS_PONENS;
+    te->modus_ponens.A = A;
+    te->modus_ponens.A_impl_B = A_impl_B;
+}
+
+void TrueExpr_Axiom(true_expr_t *te, expr_t *axiom, expr_t *A, expr_t *B, expr_t *C)
+{
+    te->type = INFERENCE_AXIOM;
+    te->axiom.axiom = axiom;
+    te->axiom.A = A;
+    te->axiom.B = B;
+    te->axiom.C = C;
+}
+
+void TrueExpr_Deduction(true_expr_t *te)
+{
+    te->type = INFERENCE_DEDUCTION;
+}
+
+void TrueExpr_Rule(true_expr_t *te, int rule, int steps, expr_t *first, expr_t *second)
+{
+    te->type = INFERENCE_RULE;
+    te->rule.rule = rule;
+    te->rule.steps = steps;
+    te->rule.premises[0] = first;
+    te->rule.premises[1] = second;
+}
+
+void AddTerm(expr_t* e)
+{
+    terms_set_insert(&terms, e);
+}
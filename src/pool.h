@@ -0,0 +1,119 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include "expr.h"
+#include <stdbool.h>
+
+typedef enum {
+    INFERENCE_AXIOM,
+    INFERENCE_MODUS_PONENS,
+    INFERENCE_DEDUCTION,
+    INFERENCE_RULE
+} inference_type_t;
+
+typedef struct {
+    expr_t *axiom;
+    expr_t *A, *B, *C;
+} axiom_inst_t;
+
+typedef struct {
+    expr_t *A_impl_B;
+    expr_t *A;
+} mp_inst_t;
+
+/* A derived rule (see rules.h) applied to one or two premises; steps is the
+ * number of axiom and MP steps it expands to. */
+typedef struct {
+    int rule;
+    int steps;
+    expr_t *premises[2];
+} rule_inst_t;
+
+typedef enum {
+    PROOF_METRIC_SIZE,
+    PROOF_METRIC_DEPTH
+} proof_metric_t;
+
+/* An alternative justification of a pool formula, kept only when
+ * pool_record_derivations is set. */
+typedef struct derivation_t {
+    inference_type_t type;
+
+    union {
+        axiom_inst_t axiom;
+        mp_inst_t modus_ponens;
+        rule_inst_t rule;
+    };
+
+    struct derivation_t *next;
+} derivation_t;
+
+typedef struct true_expr_t {
+    expr_t *e;
+    inference_type_t type;
+    int idx;
+
+    union {
+        axiom_inst_t axiom;
+        mp_inst_t modus_ponens;
+        rule_inst_t rule;
+
+        struct {
+            // todo;
+        } deduction;
+    };
+
+    derivation_t *alt;
+    uint64_t cost;
+
+    bool mp_recorded;
+} true_expr_t;
+
+#define NAME pool_map
+#define KEY_TY expr_t*
+#define VAL_TY true_expr_t
+#define HASH_FN Expr_Hash
+#define CMPR_FN Expr_Equal
+#include "verstable.h"
+
+#define NAME terms_set
+#define KEY_TY expr_t*
+#define HASH_FN Expr_Hash
+#define CMPR_FN Expr_Equal
+#include "verstable.h"
+
+/* Per-goal state; every thread proving goals has its own. */
+extern _Thread_local pool_map pool;
+extern _Thread_local terms_set terms;
+extern _Thread_local bool pool_record_derivations;
+
+/* Pool state kept aside while another one is in use, see Pool_Swap. */
+typedef struct {
+    pool_map pool;
+    terms_set terms;
+    derivation_t **derivation_blocks;
+    int derivation_block_count;
+    int derivation_idx;
+    bool record_derivations;
+} pool_state_t;
+
+void Pool_InitState(pool_state_t *st, bool record_derivations);
+void Pool_FreeState(pool_state_t *st);
+void Pool_Swap(pool_state_t *st);
+
+true_expr_t *FindExprInPool(expr_t *e);
+expr_t *FindExprInTerms(expr_t *e);
+
+void TrueExpr_Init(true_expr_t *te, expr_t *e);
+void TrueExpr_ModusPonens(true_expr_t *te, expr_t *A_impl_B, expr_t *A);
+void TrueExpr_Axiom(true_expr_t *te, expr_t *axiom, expr_t *A, expr_t *B, expr_t *C);
+void TrueExpr_Deduction(true_expr_t *te);
+void TrueExpr_Rule(true_expr_t *te, int rule, int steps, expr_t *first, expr_t *second);
+
+void AddToPool(true_expr_t* te);
+void AddAlternative(true_expr_t *te, true_expr_t *other);
+void Pool_SelectCheapest(proof_metric_t metric);
+void Pool_Reset(void);
+void AddTerm(expr_t* e);
+
+#endif
@@ -0,0 +1,394 @@
+#include "poolimage.h"
+#include "writer.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NAME expr_ids
+#define KEY_TY uint64_t
+#define VAL_TY uint32_t
+#include "verstable.h"
+
+#define FNV_OFFSET 14695981039346656037ull
+#define FNV_PRIME  1099511628211ull
+
+static uint64_t Fnv(writer_t *w, expr_t *e)
+{
+    w->len = 0;
+    Writer_Expr(w, e);
+
+    uint64_t hash = FNV_OFFSET;
+    for (size_t i = 0; i < w->len; i++) {
+        hash = (hash ^ (unsigned char)w->buf[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/*
+ * Hashes the printed axioms in file order and the printed terms, renamed
+ * by canon, in any order (the term set's iteration order is not part of
+ * its identity). Alpha-equivalent goals get the same fingerprint.
+ */
+uint64_t PoolImage_Fingerprint(renaming_t *canon, expr_t **axioms, int axiom_count)
+{
+    writer_t w;
+    Writer_Init(&w, -1);
+
+    uint64_t hash = FNV_OFFSET;
+    for (int i = 0; i < axiom_count; i++) {
+        hash = (hash ^ Fnv(&w, axioms[i])) * FNV_PRIME;
+    }
+
+    uint64_t terms_hash = terms_set_size(&terms);
+    for (terms_set_itr it = terms_set_first(&terms); !terms_set_is_end(it); it = terms_set_next(it)) {
+        expr_t *term = Canon_Apply(canon, it.data->key);
+        terms_hash += Fnv(&w, term);
+        Expr_Free(term);
+    }
+
+    Writer_Free(&w);
+    return (hash ^ terms_hash) * FNV_PRIME;
+}
+
+/* Goal formulas and schemas are numbered apart, since they share interned atoms. */
+typedef struct {
+    expr_ids ids;
+    expr_ids raw_ids;
+    renaming_t *canon;
+    poolimage_expr_t *exprs;
+    uint32_t count, cap;
+} numbering_t;
+
+typedef struct {
+    expr_t *e;
+    int state;
+} number_frame_t;
+
+/* Records e after its children, so every child is numbered before its parent. */
+static uint32_t Number(numbering_t *n, expr_t *e, bool raw)
+{
+    if (e == NULL) return UINT32_MAX;
+
+    expr_ids *ids = raw ? &n->raw_ids : &n->ids;
+
+    number_frame_t frames_local[64];
+    number_frame_t *frames = frames_local;
+    int sp = 0, cap = 64;
+
+    uint32_t values_local[64];
+    uint32_t *values = values_local;
+    int vp = 0, vcap = 64;
+
+    frames[sp++] = (number_frame_t){ e, 0 };
+    while (sp > 0) {
+        number_frame_t *f = &frames[sp - 1];
+        e = f->e;
+
+        if (vp + 1 > vcap) values = Expr_GrowStack(values, values_local, &vcap, sizeof(uint32_t));
+
+        if (f->state == 0) {
+            expr_ids_itr iter = expr_ids_get(ids, (uintptr_t)e);
+            if (!expr_ids_is_end(iter)) {
+                values[vp++] = iter.data->val;
+                sp--;
+                continue;
+            }
+            if (e->type != EXPR_ATOM) {
+                f->state = 1;
+                if (sp + 2 > cap) frames = Expr_GrowStack(frames, frames_local, &cap, sizeof(number_frame_t));
+                if (e->type == EXPR_IMPLIES) {
+                    frames[sp++] = (number_frame_t){ e->implies.b, 0 };
+                    frames[sp++] = (number_frame_t){ e->implies.a, 0 };
+                }
+                else {
+                    frames[sp++] = (number_frame_t){ e->not.a, 0 };
+                }
+                continue;
+            }
+        }
+        sp--;
+
+        poolimage_expr_t rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.type = e->type;
+        rec.flags = raw ? POOLIMAGE_EXPR_RAW : 0;
+
+        switch (e->type) {
+        case EXPR_IMPLIES:
+            rec.children.b = values[--vp];
+            rec.children.a = values[--vp];
+            break;
+        case EXPR_NOT:
+            rec.children.a = values[--vp];
+            break;
+        case EXPR_ATOM: {
+            const char *name = raw ? NULL : Canon_Lookup(n->canon, e->atom.name);
+            if (name == NULL) name = e->atom.name;
+            size_t len = strnlen(name, sizeof(rec.name) - 1);
+            memcpy(rec.name, name, len);
+            rec.name[len] = '\0';
+            break;
+        }
+        }
+
+        if (n->count == n->cap) {
+            n->cap = n->cap ? n->cap * 2 : 1024;
+            n->exprs = realloc(n->exprs, n->cap * sizeof(poolimage_expr_t));
+            if (n->exprs == NULL) {
+                fprintf(stderr, "Out of memory\n");
+                exit(1);
+            }
+        }
+        n->exprs[n->count] = rec;
+        expr_ids_insert(ids, (uintptr_t)e, n->count);
+        values[vp++] = n->count++;
+    }
+
+    uint32_t id = values[0];
+    if (frames != frames_local) free(frames);
+    if (values != values_local) free(values);
+    return id;
+}
+
+/*
+ * Writes the image next to path and renames it into place, so a reader
+ * that maps path, in this process or another, never sees it truncated or
+ * half written.
+ */
+int PoolImage_Save(const char *path, uint64_t fingerprint, renaming_t *canon, expr_t **axioms, int axiom_count)
+{
+    size_t len = strlen(path) + 32;
+    char *tmp_path = malloc(len);
+    if (tmp_path == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    snprintf(tmp_path, len, "%s.tmp.%d", path, (int)getpid());
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        free(tmp_path);
+        return -1;
+    }
+
+    numbering_t n;
+    memset(&n, 0, sizeof(n));
+    expr_ids_init(&n.ids);
+    expr_ids_init(&n.raw_ids);
+    n.canon = canon;
+
+    uint32_t entry_count = pool_map_size(&pool);
+    poolimage_entry_t *entries = calloc(entry_count + 1, sizeof(poolimage_entry_t));
+    uint32_t term_count = terms_set_size(&terms);
+    uint32_t *term_ids = calloc(term_count + 1, sizeof(uint32_t));
+    uint32_t *axiom_ids = calloc(axiom_count + 1, sizeof(uint32_t));
+
+    uint32_t i = 0;
+    for (pool_map_itr it = pool_map_first(&pool); !pool_map_is_end(it); it = pool_map_next(it), i++) {
+        true_expr_t *te = &it.data->val;
+        poolimage_entry_t *entry = &entries[i];
+
+        entry->e = Number(&n, te->e, false);
+        entry->type = te->type;
+        entry->idx = te->idx;
+        for (int j = 0; j < 4; j++) entry->args[j] = UINT32_MAX;
+
+        if (te->type == INFERENCE_AXIOM) {
+            entry->args[0] = Number(&n, te->axiom.axiom, true);
+            entry->args[1] = Number(&n, te->axiom.A, false);
+            entry->args[2] = Number(&n, te->axiom.B, false);
+            entry->args[3] = Number(&n, te->axiom.C, false);
+        }
+        else if (te->type == INFERENCE_MODUS_PONENS) {
+            entry->args[0] = Number(&n, te->modus_ponens.A_impl_B, false);
+            entry->args[1] = Number(&n, te->modus_ponens.A, false);
+        }
+    }
+
+    i = 0;
+    for (terms_set_itr it = terms_set_first(&terms); !terms_set_is_end(it); it = terms_set_next(it)) {
+        term_ids[i++] = Number(&n, it.data->key, false);
+    }
+    for (int j = 0; j < axiom_count; j++) {
+        axiom_ids[j] = Number(&n, axioms[j], true);
+    }
+
+    poolimage_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, POOLIMAGE_MAGIC, sizeof(POOLIMAGE_MAGIC));
+    header.version = POOLIMAGE_VERSION;
+    header.expr_count = n.count;
+    header.entry_count = entry_count;
+    header.term_count = term_count;
+    header.axiom_count = axiom_count;
+    header.fingerprint = fingerprint;
+
+    writer_t w;
+    Writer_Init(&w, fd);
+    Writer_Put(&w, (char *)&header, sizeof(header));
+    Writer_Put(&w, (char *)n.exprs, n.count * sizeof(poolimage_expr_t));
+    Writer_Put(&w, (char *)entries, entry_count * sizeof(poolimage_entry_t));
+    Writer_Put(&w, (char *)term_ids, term_count * sizeof(uint32_t));
+    Writer_Put(&w, (char *)axiom_ids, axiom_count * sizeof(uint32_t));
+    int res = Writer_Free(&w);
+
+    expr_ids_cleanup(&n.ids);
+    expr_ids_cleanup(&n.raw_ids);
+    free(n.exprs);
+    free(entries);
+    free(term_ids);
+    free(axiom_ids);
+    if (close(fd) != 0) res = -1;
+    if (res == 0 && rename(tmp_path, path) != 0) res = -1;
+    if (res != 0) unlink(tmp_path);
+    free(tmp_path);
+    return res;
+}
+
+static expr_t *Ref(expr_t *exprs, uint32_t count, uint32_t id, bool *ok)
+{
+    if (id == UINT32_MAX) return NULL;
+    if (id >= count) {
+        *ok = false;
+        return NULL;
+    }
+    return exprs + id;
+}
+
+/*
+ * Maps the image, copies its expression table into one arena block while
+ * turning indices back into pointers and renaming atoms with inverse, and
+ * refills the pool and the term set. Children precede their parents in the
+ * table, so hashes and print lengths are recomputed in one pass at O(1)
+ * per node. Returns -1 without touching the pool if the image is missing,
+ * malformed (including an entry of unknown type, or an axiom or modus
+ * ponens entry without its schema or premises) or was made for other
+ * axioms or terms.
+ */
+int PoolImage_Load(const char *path, uint64_t fingerprint, renaming_t *inverse)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(poolimage_header_t)) {
+        close(fd);
+        return -1;
+    }
+
+    char *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+
+    const poolimage_header_t *h = (const poolimage_header_t *)base;
+    uint64_t size = sizeof(poolimage_header_t) +
+                    (uint64_t)h->expr_count * sizeof(poolimage_expr_t) +
+                    (uint64_t)h->entry_count * sizeof(poolimage_entry_t) +
+                    (uint64_t)h->term_count * sizeof(uint32_t) +
+                    (uint64_t)h->axiom_count * sizeof(uint32_t);
+
+    if (memcmp(h->magic, POOLIMAGE_MAGIC, sizeof(POOLIMAGE_MAGIC)) != 0 ||
+        h->version != POOLIMAGE_VERSION || h->fingerprint != fingerprint ||
+        size > (uint64_t)st.st_size) {
+        munmap(base, st.st_size);
+        return -1;
+    }
+
+    const poolimage_expr_t *recs = (const poolimage_expr_t *)(h + 1);
+    const poolimage_entry_t *entries = (const poolimage_entry_t *)(recs + h->expr_count);
+    const uint32_t *term_ids = (const uint32_t *)(entries + h->entry_count);
+
+    bool ok = true;
+    expr_mark_t mark = Expr_Mark();
+    expr_t *exprs = Expr_AllocArray(h->expr_count);
+    for (uint32_t i = 0; i < h->expr_count && ok; i++) {
+        const poolimage_expr_t *rec = &recs[i];
+        expr_t *e = &exprs[i];
+
+        memset(e, 0, sizeof(expr_t));
+        e->type = rec->type;
+
+        switch (rec->type) {
+        case EXPR_IMPLIES:
+            e->implies.a = Ref(exprs, i, rec->children.a, &ok);
+            e->implies.b = Ref(exprs, i, rec->children.b, &ok);
+            ok = ok && e->implies.a != NULL && e->implies.b != NULL;
+            break;
+        case EXPR_NOT:
+            e->not.a = Ref(exprs, i, rec->children.a, &ok);
+            ok = ok && e->not.a != NULL;
+            break;
+        case EXPR_ATOM: {
+            memcpy(e->atom.name, rec->name, sizeof(e->atom.name));
+            e->atom.name[sizeof(e->atom.name) - 1] = '\0';
+            const char *name = rec->flags & POOLIMAGE_EXPR_RAW ? NULL : Canon_Lookup(inverse, e->atom.name);
+            if (name != NULL) strcpy(e->atom.name, name);
+            break;
+        }
+        default:
+            ok = false;
+        }
+
+        if (ok) {
+            Expr_Hash(e);
+            Expr_Length(e);
+        }
+    }
+
+    /* Rule entries are never saved, since their premises are not stored. */
+    for (uint32_t i = 0; i < h->entry_count && ok; i++) {
+        const poolimage_entry_t *entry = &entries[i];
+        ok = entry->e < h->expr_count;
+        for (int j = 0; j < 4 && ok; j++) {
+            ok = entry->args[j] == UINT32_MAX || entry->args[j] < h->expr_count;
+        }
+        if (entry->type == INFERENCE_AXIOM) ok = ok && entry->args[0] != UINT32_MAX;
+        else if (entry->type == INFERENCE_MODUS_PONENS) ok = ok && entry->args[0] != UINT32_MAX && entry->args[1] != UINT32_MAX;
+        else ok = ok && entry->type == INFERENCE_DEDUCTION;
+    }
+    for (uint32_t i = 0; i < h->term_count && ok; i++) {
+        ok = term_ids[i] < h->expr_count;
+    }
+
+    if (!ok) {
+        Expr_Release(mark);
+        munmap(base, st.st_size);
+        return -1;
+    }
+
+    pool_map_clear(&pool);
+    pool_map_reserve(&pool, h->entry_count);
+    for (uint32_t i = 0; i < h->entry_count; i++) {
+        const poolimage_entry_t *entry = &entries[i];
+        uint32_t n = h->expr_count;
+
+        true_expr_t te;
+        TrueExpr_Init(&te, &exprs[entry->e]);
+        te.idx = entry->idx;
+        te.type = entry->type;
+        if (entry->type == INFERENCE_AXIOM) {
+            te.axiom.axiom = Ref(exprs, n, entry->args[0], &ok);
+            te.axiom.A = Ref(exprs, n, entry->args[1], &ok);
+            te.axiom.B = Ref(exprs, n, entry->args[2], &ok);
+            te.axiom.C = Ref(exprs, n, entry->args[3], &ok);
+        }
+        else if (entry->type == INFERENCE_MODUS_PONENS) {
+            te.modus_ponens.A_impl_B = Ref(exprs, n, entry->args[0], &ok);
+            te.modus_ponens.A = Ref(exprs, n, entry->args[1], &ok);
+        }
+        pool_map_insert(&pool, te.e, te);
+    }
+
+    terms_set_clear(&terms);
+    terms_set_reserve(&terms, h->term_count);
+    for (uint32_t i = 0; i < h->term_count; i++) {
+        terms_set_insert(&terms, &exprs[term_ids[i]]);
+    }
+
+    munmap(base, st.st_size);
+    return 0;
+}
@@ -0,0 +1,67 @@
+#ifndef POOLIMAGE_H
+#define POOLIMAGE_H
+
+#include "canon.h"
+#include "pool.h"
+#include <stdint.h>
+
+/*
+ * Snapshot of the instantiated pool. Expressions are stored as a table in
+ * which children are indices instead of pointers, so the image does not
+ * depend on where the arena lives:
+ *
+ *   header
+ *   exprs    expr_count  x poolimage_expr_t
+ *   entries  entry_count x poolimage_entry_t
+ *   terms    term_count  x expr index
+ *   axioms   axiom_count x expr index
+ *
+ * The fingerprint covers the axioms and the term set, which are all the
+ * instantiation depends on. Atoms are stored under the goal's canonical
+ * renaming (see canon.h), so one image serves alpha-equivalent goals,
+ * except in the axioms and the schemas of axiom instances: their A, B, C
+ * are schema variables, not goal atoms, and are stored as they are
+ * (POOLIMAGE_EXPR_RAW).
+ */
+
+#define POOLIMAGE_MAGIC   "MPPOOL"
+#define POOLIMAGE_VERSION 3
+
+#define POOLIMAGE_EXPR_RAW 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t expr_count;
+    uint32_t entry_count;
+    uint32_t term_count;
+    uint32_t axiom_count;
+    uint32_t reserved;
+    uint64_t fingerprint;
+} poolimage_header_t;
+
+typedef struct {
+    uint32_t type;
+    uint32_t flags;
+
+    union {
+        struct {
+            uint32_t a, b;
+        } children;
+
+        char name[16];
+    };
+} poolimage_expr_t;
+
+typedef struct {
+    uint32_t e;
+    uint32_t type;
+    int32_t idx;
+    uint32_t args[4];
+} poolimage_entry_t;
+
+uint64_t PoolImage_Fingerprint(renaming_t *canon, expr_t **axioms, int axiom_count);
+int PoolImage_Save(const char *path, uint64_t fingerprint, renaming_t *canon, expr_t **axioms, int axiom_count);
+int PoolImage_Load(const char *path, uint64_t fingerprint, renaming_t *inverse);
+
+#endif
@@ -0,0 +1,117 @@
+#include "portfolio.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PORTFOLIO_SLICE 10000
+
+typedef struct {
+    portfolio_t *pf;
+    int i;
+    atomic_bool *decided;
+    pthread_mutex_t *lock;
+} race_job_t;
+
+/*
+ * Entrant i flips the root's +neg, +self_impl and +rules settings by the
+ * bits of i, so entrant 0 is the root configuration. If the axioms support
+ * no rules, the entrants that would turn them on are left out. Only
+ * entrant 0 uses pool images: their fingerprint does not cover the
+ * options.
+ */
+void Portfolio_Init(portfolio_t *pf, prover_ctx_t *root)
+{
+    memset(pf, 0, sizeof(portfolio_t));
+    pf->winner = -1;
+
+    for (int i = 0; i < PORTFOLIO_SIZE; i++) {
+        prover_options_t opts = root->opts;
+        if (i & 1) opts.add_neg_terms = !opts.add_neg_terms;
+        if (i & 2) opts.add_self_impl = !opts.add_self_impl;
+        if (i & 4) opts.enabled_rules = opts.enabled_rules ? 0 : RULES_ALL;
+        if (i != 0) opts.save_pool_path = opts.load_pool_path = NULL;
+
+        prover_ctx_t *ctx = Prover_CreateVariant(root, &opts);
+        if (opts.enabled_rules != 0 && ctx->rules.enabled == 0 && root->rules.enabled == 0) {
+            Prover_Destroy(ctx);
+            break;
+        }
+        pf->entrants[pf->count++].ctx = ctx;
+    }
+}
+
+static void *Race(void *arg)
+{
+    race_job_t *job = arg;
+    portfolio_entrant_t *e = &job->pf->entrants[job->i];
+
+    writer_t saved = out;
+    Writer_Init(&out, -1);
+    e->status = Prover_Start(e->ctx);
+    while (e->status == PROVER_RUNNING && !atomic_load(job->decided)) {
+        e->status = Prover_Step(e->ctx, PORTFOLIO_SLICE);
+    }
+
+    if (e->status == PROVER_FOUND) {
+        pthread_mutex_lock(job->lock);
+        if (job->pf->winner < 0) job->pf->winner = job->i;
+        pthread_mutex_unlock(job->lock);
+        atomic_store(job->decided, true);
+    }
+
+    /* Keep what the entrant printed; the caller shows the winner's. */
+    e->output = out;
+    out = saved;
+    return NULL;
+}
+
+/*
+ * Proves the goal on [begin, end) with every entrant at once and returns
+ * the context of the first one to find a proof, or NULL. Entrants that are
+ * still searching are cancelled at the end of their current slice.
+ */
+prover_ctx_t *Portfolio_Prove(portfolio_t *pf, const char *begin, const char *end)
+{
+    atomic_bool decided = false;
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    race_job_t jobs[PORTFOLIO_SIZE];
+    pthread_t tids[PORTFOLIO_SIZE];
+    bool started[PORTFOLIO_SIZE];
+
+    pf->winner = -1;
+    for (int i = 0; i < pf->count; i++) {
+        portfolio_entrant_t *e = &pf->entrants[i];
+        Writer_Free(&e->output);
+        e->status = PROVER_NOT_FOUND;
+        Prover_Reset(e->ctx);
+        Prover_SetGoal(e->ctx, begin, end);
+        jobs[i] = (race_job_t){ pf, i, &decided, &lock };
+        started[i] = pthread_create(&tids[i], NULL, Race, &jobs[i]) == 0;
+    }
+
+    for (int i = 0; i < pf->count; i++) {
+        if (started[i]) pthread_join(tids[i], NULL);
+        else if (!atomic_load(&decided)) Race(&jobs[i]);
+    }
+
+    pthread_mutex_destroy(&lock);
+    return pf->winner >= 0 ? pf->entrants[pf->winner].ctx : NULL;
+}
+
+void Portfolio_WriteName(portfolio_t *pf, int i, writer_t *w)
+{
+    prover_options_t *opts = &pf->entrants[i].ctx->opts;
+    Writer_Str(w, opts->add_neg_terms ? "+neg" : "-neg");
+    Writer_Str(w, opts->add_self_impl ? " +self_impl" : " -self_impl");
+    Writer_Str(w, opts->enabled_rules ? " +rules" : " -rules");
+}
+
+void Portfolio_Free(portfolio_t *pf)
+{
+    for (int i = 0; i < pf->count; i++) {
+        Writer_Free(&pf->entrants[i].output);
+        Prover_Destroy(pf->entrants[i].ctx);
+    }
+    pf->count = 0;
+}
@@ -0,0 +1,32 @@
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+#include "prover.h"
+
+/*
+ * Races search configurations on one goal. Every combination of +neg,
+ * +self_impl and +rules is an entrant with its own context and thread,
+ * the root's own options first; they share the root's axioms, schemas and
+ * lemma database. Entrants run in slices and check between slices whether
+ * another one has found a proof, so the first proof ends the race.
+ */
+#define PORTFOLIO_SIZE 8
+
+typedef struct {
+    prover_ctx_t *ctx;
+    writer_t output;
+    prover_status_t status;
+} portfolio_entrant_t;
+
+typedef struct {
+    portfolio_entrant_t entrants[PORTFOLIO_SIZE];
+    int count;
+    int winner;
+} portfolio_t;
+
+void Portfolio_Init(portfolio_t *pf, prover_ctx_t *root);
+prover_ctx_t *Portfolio_Prove(portfolio_t *pf, const char *begin, const char *end);
+void Portfolio_WriteName(portfolio_t *pf, int i, writer_t *w);
+void Portfolio_Free(portfolio_t *pf);
+
+#endif
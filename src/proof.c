@@ -0,0 +1,208 @@
+#include "proof.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+void Proof_Init(proof_t *proof)
+{
+    proof->steps = NULL;
+    proof->count = 0;
+    proof->capacity = 0;
+}
+
+void Proof_Free(proof_t *proof)
+{
+    free(proof->steps);
+    Proof_Init(proof);
+}
+
+int Proof_Push(proof_t *proof, proof_step_t *step)
+{
+    if (proof->count == proof->capacity) {
+        int capacity = proof->capacity ? proof->capacity * 2 : 64;
+        proof_step_t *steps = realloc(proof->steps, capacity * sizeof(proof_step_t));
+        if (steps == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+        proof->steps = steps;
+        proof->capacity = capacity;
+    }
+
+    proof->steps[proof->count] = *step;
+    return proof->count++;
+}
+
+void Proof_BuilderInit(proof_builder_t *b, proof_t *proof)
+{
+    b->proof = proof;
+    step_map_init(&b->emitted);
+}
+
+void Proof_BuilderFree(proof_builder_t *b)
+{
+    step_map_cleanup(&b->emitted);
+}
+
+int Proof_Emit(proof_builder_t *b, proof_step_t *step, bool reuse)
+{
+    if (reuse) {
+        step_map_itr iter = step_map_get(&b->emitted, step->e);
+        if (!step_map_is_end(iter)) return iter.data->val;
+    }
+
+    int idx = Proof_Push(b->proof, step);
+    step_map_insert(&b->emitted, step->e, idx);
+    return idx;
+}
+
+typedef struct {
+    true_expr_t *te;
+    int state;
+} extract_frame_t;
+
+static int FindStep(step_map *emitted, expr_t *e)
+{
+    step_map_itr iter = step_map_get(emitted, e);
+    if (step_map_is_end(iter)) {
+        return -1;
+    }
+    return iter.data->val;
+}
+
+/*
+ * Post-order walk from the goal over the pool justifications. Premises are
+ * emitted before the step using them (minor premise first, as PrintHistory
+ * used to do), and each formula is emitted once. The pool itself is only
+ * read, never marked.
+ */
+int Proof_Extract(proof_t *proof, true_expr_t *goal)
+{
+    step_map emitted;
+    step_map_init(&emitted);
+
+    extract_frame_t local[64];
+    extract_frame_t *stack = local;
+    int sp = 0, cap = 64;
+    stack[sp++] = (extract_frame_t){ goal, 0 };
+
+    while (sp > 0) {
+        extract_frame_t *f = &stack[sp - 1];
+        true_expr_t *te = f->te;
+
+        if (f->state == 0 && FindStep(&emitted, te->e) >= 0) {
+            sp--;
+            continue;
+        }
+
+        expr_t *premise = NULL;
+        if (te->type == INFERENCE_MODUS_PONENS && f->state < 2) {
+            premise = f->state == 0 ? te->modus_ponens.A : te->modus_ponens.A_impl_B;
+        }
+        else if (te->type == INFERENCE_RULE && f->state < 2) {
+            premise = te->rule.premises[f->state];
+        }
+
+        if (premise != NULL) {
+            f->state++;
+
+            if (FindStep(&emitted, premise) < 0) {
+                if (sp + 1 > cap) stack = Expr_GrowStack(stack, local, &cap, sizeof(extract_frame_t));
+                stack[sp++] = (extract_frame_t){ FindExprInPool(premise), 0 };
+            }
+            continue;
+        }
+
+        proof_step_t step;
+        step.e = te->e;
+        step.type = te->type;
+        switch (te->type) {
+        case INFERENCE_AXIOM:
+            step.axiom = te->axiom;
+            break;
+        case INFERENCE_MODUS_PONENS:
+            step.modus_ponens.A_impl_B = FindStep(&emitted, te->modus_ponens.A_impl_B);
+            step.modus_ponens.A = FindStep(&emitted, te->modus_ponens.A);
+            break;
+        case INFERENCE_RULE:
+            step.rule.rule = te->rule.rule;
+            step.rule.premises[0] = FindStep(&emitted, te->rule.premises[0]);
+            step.rule.premises[1] = te->rule.premises[1] != NULL ? FindStep(&emitted, te->rule.premises[1]) : -1;
+            break;
+        case INFERENCE_DEDUCTION:
+            break;
+        }
+
+        step_map_insert(&emitted, te->e, Proof_Push(proof, &step));
+        sp--;
+    }
+
+    if (stack != local) free(stack);
+    step_map_cleanup(&emitted);
+    return proof->count;
+}
+
+void PrintAxiom(writer_t *w, expr_t *e, axiom_inst_t *ax, int idx)
+{
+    Writer_Str(w, "   Axiom = ");
+    Writer_Expr(w, ax->axiom);
+    Writer_Str(w, "\n       A = ");
+    Writer_Expr(w, ax->A);
+    Writer_Str(w, "\n       B = ");
+    Writer_Expr(w, ax->B);
+    Writer_Str(w, "\n       C = ");
+    Writer_Expr(w, ax->C);
+    Writer_Str(w, "\n");
+
+    Writer_Str(w, "  ");
+    Writer_Int(w, idx, 3);
+    Writer_Char(w, ' ');
+    Writer_Expr(w, e);
+    Writer_Str(w, "\n\n");
+}
+
+static void PrintModusPonens(writer_t *w, proof_t *proof, int idx)
+{
+    proof_step_t *step = &proof->steps[idx];
+    int A_impl_B = step->modus_ponens.A_impl_B;
+    int A = step->modus_ponens.A;
+
+    Writer_Int(w, A_impl_B + 1, 5);
+    Writer_Char(w, ' ');
+    Writer_Expr(w, proof->steps[A_impl_B].e);
+    Writer_Str(w, ",\n");
+    Writer_Int(w, A + 1, 5);
+    Writer_Str(w, "  ");
+    int len = Writer_Expr(w, proof->steps[A].e);
+    Writer_Char(w, '\n');
+    Writer_Int(w, idx + 1, 5);
+    Writer_Char(w, ' ');
+    Writer_Pad(w, ' ', len);
+    Writer_Str(w, "  |- ");
+    Writer_Expr(w, step->e);
+    Writer_Str(w, "\n\n");
+}
+
+void Proof_Print(writer_t *w, proof_t *proof)
+{
+    for (int i = 0; i < proof->count; i++) {
+        proof_step_t *step = &proof->steps[i];
+
+        switch (step->type) {
+        case INFERENCE_AXIOM:
+            PrintAxiom(w, step->e, &step->axiom, i + 1);
+            break;
+        case INFERENCE_MODUS_PONENS:
+            PrintModusPonens(w, proof, i);
+            break;
+        case INFERENCE_DEDUCTION:
+            Writer_Int(w, i + 1, 5);
+            Writer_Str(w, " DEDUCTED ");
+            Writer_Expr(w, step->e);
+            Writer_Char(w, '\n');
+            break;
+        case INFERENCE_RULE:
+            ASSERT(false, "rule steps are expanded before printing");
+            break;
+        }
+    }
+}
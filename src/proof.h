@@ -0,0 +1,67 @@
+#ifndef PROOF_H
+#define PROOF_H
+
+#include "pool.h"
+#include "writer.h"
+
+/*
+ * A proof is the part of the pool reachable from the goal, laid out as a
+ * topologically ordered array: every premise comes before the step that
+ * uses it. Step numbers are dense array indices (printed 1-based).
+ */
+typedef struct {
+    expr_t *e;
+    inference_type_t type;
+
+    union {
+        axiom_inst_t axiom;
+
+        struct {
+            int A_impl_B;
+            int A;
+        } modus_ponens;
+
+        struct {
+            int rule;
+            int premises[2];
+        } rule;
+    };
+} proof_step_t;
+
+typedef struct {
+    proof_step_t *steps;
+    int count;
+    int capacity;
+} proof_t;
+
+#define NAME step_map
+#define KEY_TY expr_t*
+#define VAL_TY int
+#define HASH_FN Expr_Hash
+#define CMPR_FN Expr_Equal
+#include "verstable.h"
+
+/*
+ * Rebuilds a proof step by step while expanding macro steps (derived rules
+ * and schemas) into axiom and MP steps. Formulas already emitted are
+ * reused unless the caller asks for a fresh step.
+ */
+typedef struct {
+    proof_t *proof;
+    step_map emitted;
+} proof_builder_t;
+
+void Proof_Init(proof_t *proof);
+void Proof_Free(proof_t *proof);
+int  Proof_Push(proof_t *proof, proof_step_t *step);
+
+int  Proof_Extract(proof_t *proof, true_expr_t *goal);
+void Proof_Print(writer_t *w, proof_t *proof);
+
+void Proof_BuilderInit(proof_builder_t *b, proof_t *proof);
+void Proof_BuilderFree(proof_builder_t *b);
+int  Proof_Emit(proof_builder_t *b, proof_step_t *step, bool reuse);
+
+void PrintAxiom(writer_t *w, expr_t *e, axiom_inst_t *ax, int idx);
+
+#endif
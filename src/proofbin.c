@@ -0,0 +1,421 @@
+#include "proofbin.h"
+#include "writer.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NAME node_map
+#define KEY_TY expr_t*
+#define VAL_TY uint32_t
+#define HASH_FN Expr_Hash
+#define CMPR_FN Expr_Equal
+#include "verstable.h"
+
+typedef struct {
+    node_map node_ids;
+    node_map atom_ids;
+    node_map axiom_ids;
+
+    proofbin_node_t *nodes;
+    uint32_t node_count, node_cap;
+
+    proofbin_atom_t *atoms;
+    uint32_t atom_count, atom_cap;
+
+    char *strtab;
+    uint32_t strtab_size, strtab_cap;
+
+    uint32_t *axioms;
+    uint32_t axiom_count, axiom_cap;
+
+    proofbin_step_t *steps;
+    uint32_t step_count;
+} builder_t;
+
+static void *Grow(void *ptr, uint32_t *cap, uint32_t need, size_t elem)
+{
+    if (need <= *cap) return ptr;
+
+    while (*cap < need) *cap = *cap ? *cap * 2 : 64;
+    ptr = realloc(ptr, (size_t)*cap * elem);
+    if (ptr == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    return ptr;
+}
+
+static uint32_t InternAtom(builder_t *b, expr_t *e)
+{
+    node_map_itr iter = node_map_get(&b->atom_ids, e);
+    if (!node_map_is_end(iter)) return iter.data->val;
+
+    uint32_t len = Expr_Length(e);
+    b->strtab = Grow(b->strtab, &b->strtab_cap, b->strtab_size + len, 1);
+    memcpy(b->strtab + b->strtab_size, e->atom.name, len);
+
+    b->atoms = Grow(b->atoms, &b->atom_cap, b->atom_count + 1, sizeof(proofbin_atom_t));
+    b->atoms[b->atom_count] = (proofbin_atom_t){ b->strtab_size, len };
+    b->strtab_size += len;
+
+    node_map_insert(&b->atom_ids, e, b->atom_count);
+    return b->atom_count++;
+}
+
+typedef struct {
+    expr_t *e;
+    int state;
+} intern_frame_t;
+
+/* Nodes are stored after their children, so a node only refers to smaller ids. */
+static uint32_t InternNode(builder_t *b, expr_t *e)
+{
+    if (e == NULL) return PROOFBIN_NONE;
+
+    intern_frame_t frames_local[64];
+    intern_frame_t *frames = frames_local;
+    int sp = 0, cap = 64;
+
+    uint32_t values_local[64];
+    uint32_t *values = values_local;
+    int vp = 0, vcap = 64;
+
+    frames[sp++] = (intern_frame_t){ e, 0 };
+    while (sp > 0) {
+        intern_frame_t *f = &frames[sp - 1];
+        e = f->e;
+
+        if (vp + 1 > vcap) values = Expr_GrowStack(values, values_local, &vcap, sizeof(uint32_t));
+
+        if (f->state == 0) {
+            node_map_itr iter = node_map_get(&b->node_ids, e);
+            if (!node_map_is_end(iter)) {
+                values[vp++] = iter.data->val;
+                sp--;
+                continue;
+            }
+            if (e->type != EXPR_ATOM) {
+                f->state = 1;
+                if (sp + 2 > cap) frames = Expr_GrowStack(frames, frames_local, &cap, sizeof(intern_frame_t));
+                if (e->type == EXPR_IMPLIES) {
+                    frames[sp++] = (intern_frame_t){ e->implies.b, 0 };
+                    frames[sp++] = (intern_frame_t){ e->implies.a, 0 };
+                }
+                else {
+                    frames[sp++] = (intern_frame_t){ e->not.a, 0 };
+                }
+                continue;
+            }
+        }
+        sp--;
+
+        proofbin_node_t node = { e->type, PROOFBIN_NONE, PROOFBIN_NONE };
+        switch (e->type) {
+        case EXPR_IMPLIES:
+            node.b = values[--vp];
+            node.a = values[--vp];
+            break;
+        case EXPR_NOT:
+            node.a = values[--vp];
+            break;
+        case EXPR_ATOM:
+            node.a = InternAtom(b, e);
+            break;
+        }
+
+        b->nodes = Grow(b->nodes, &b->node_cap, b->node_count + 1, sizeof(proofbin_node_t));
+        b->nodes[b->node_count] = node;
+        node_map_insert(&b->node_ids, e, b->node_count);
+        values[vp++] = b->node_count++;
+    }
+
+    uint32_t id = values[0];
+    if (frames != frames_local) free(frames);
+    if (values != values_local) free(values);
+    return id;
+}
+
+static uint32_t InternAxiom(builder_t *b, expr_t *schema)
+{
+    node_map_itr iter = node_map_get(&b->axiom_ids, schema);
+    if (!node_map_is_end(iter)) return iter.data->val;
+
+    b->axioms = Grow(b->axioms, &b->axiom_cap, b->axiom_count + 1, sizeof(uint32_t));
+    b->axioms[b->axiom_count] = InternNode(b, schema);
+    node_map_insert(&b->axiom_ids, schema, b->axiom_count);
+    return b->axiom_count++;
+}
+
+static void Builder_Build(builder_t *b, proof_t *proof)
+{
+    memset(b, 0, sizeof(builder_t));
+    node_map_init(&b->node_ids);
+    node_map_init(&b->atom_ids);
+    node_map_init(&b->axiom_ids);
+
+    b->step_count = proof->count;
+    b->steps = calloc(proof->count ? proof->count : 1, sizeof(proofbin_step_t));
+
+    for (int i = 0; i < proof->count; i++) {
+        proof_step_t *step = &proof->steps[i];
+        proofbin_step_t *out_step = &b->steps[i];
+
+        out_step->type = step->type;
+        out_step->formula = InternNode(b, step->e);
+        for (int j = 0; j < 4; j++) out_step->args[j] = PROOFBIN_NONE;
+
+        switch (step->type) {
+        case INFERENCE_AXIOM:
+            out_step->args[0] = InternAxiom(b, step->axiom.axiom);
+            out_step->args[1] = InternNode(b, step->axiom.A);
+            out_step->args[2] = InternNode(b, step->axiom.B);
+            out_step->args[3] = InternNode(b, step->axiom.C);
+            break;
+        case INFERENCE_MODUS_PONENS:
+            out_step->args[0] = step->modus_ponens.A_impl_B;
+            out_step->args[1] = step->modus_ponens.A;
+            break;
+        case INFERENCE_DEDUCTION:
+            break;
+        case INFERENCE_RULE:
+            ASSERT(false, "rule steps are expanded before writing");
+            break;
+        }
+    }
+}
+
+static void Builder_Free(builder_t *b)
+{
+    node_map_cleanup(&b->node_ids);
+    node_map_cleanup(&b->atom_ids);
+    node_map_cleanup(&b->axiom_ids);
+    free(b->nodes);
+    free(b->atoms);
+    free(b->strtab);
+    free(b->axioms);
+    free(b->steps);
+}
+
+/*
+ * Interns every formula of the proof into the node table first, then
+ * streams the sections out in file order.
+ */
+void ProofBin_Encode(writer_t *w, proof_t *proof)
+{
+    builder_t b;
+    Builder_Build(&b, proof);
+
+    uint32_t padded = (b.strtab_size + 3) & ~3u;
+
+    proofbin_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PROOFBIN_MAGIC, sizeof(PROOFBIN_MAGIC));
+    header.version = PROOFBIN_VERSION;
+    header.atom_count = b.atom_count;
+    header.node_count = b.node_count;
+    header.axiom_count = b.axiom_count;
+    header.step_count = b.step_count;
+    header.goal = b.step_count ? b.steps[b.step_count - 1].formula : PROOFBIN_NONE;
+    header.strtab_size = padded;
+
+    Writer_Put(w, (char *)&header, sizeof(header));
+    Writer_Put(w, (char *)b.atoms, b.atom_count * sizeof(proofbin_atom_t));
+    Writer_Put(w, b.strtab, b.strtab_size);
+    Writer_Pad(w, '\0', padded - b.strtab_size);
+    Writer_Put(w, (char *)b.nodes, b.node_count * sizeof(proofbin_node_t));
+    Writer_Put(w, (char *)b.axioms, b.axiom_count * sizeof(uint32_t));
+    Writer_Put(w, (char *)b.steps, b.step_count * sizeof(proofbin_step_t));
+
+    Builder_Free(&b);
+}
+
+int ProofBin_Write(const char *path, proof_t *proof)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+
+    writer_t w;
+    Writer_Init(&w, fd);
+    ProofBin_Encode(&w, proof);
+    int res = Writer_Free(&w);
+
+    if (close(fd) != 0) res = -1;
+    return res;
+}
+
+bool ProofBin_Probe(const char *path)
+{
+    char magic[8];
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return false;
+
+    bool res = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+               memcmp(magic, PROOFBIN_MAGIC, sizeof(PROOFBIN_MAGIC)) == 0;
+    fclose(f);
+    return res;
+}
+
+/*
+ * Points the section arrays into an image already in memory. Only the
+ * section bounds are validated here; ProofBin_Load checks the contents.
+ */
+int ProofBin_View(const void *base, size_t size, proofbin_map_t *map)
+{
+    const proofbin_header_t *h = base;
+    if (size < sizeof(proofbin_header_t) ||
+        memcmp(h->magic, PROOFBIN_MAGIC, sizeof(PROOFBIN_MAGIC)) != 0 ||
+        h->version != PROOFBIN_VERSION || (h->strtab_size & 3) != 0) {
+        return -1;
+    }
+
+    uint64_t offset = sizeof(proofbin_header_t);
+    uint64_t atoms = offset;
+    offset += (uint64_t)h->atom_count * sizeof(proofbin_atom_t);
+    uint64_t strtab = offset;
+    offset += h->strtab_size;
+    uint64_t nodes = offset;
+    offset += (uint64_t)h->node_count * sizeof(proofbin_node_t);
+    uint64_t axioms = offset;
+    offset += (uint64_t)h->axiom_count * sizeof(uint32_t);
+    uint64_t steps = offset;
+    offset += (uint64_t)h->step_count * sizeof(proofbin_step_t);
+
+    if (offset > size) {
+        return -1;
+    }
+
+    const char *p = base;
+    map->header = h;
+    map->atoms = (const proofbin_atom_t *)(p + atoms);
+    map->strtab = p + strtab;
+    map->nodes = (const proofbin_node_t *)(p + nodes);
+    map->axioms = (const uint32_t *)(p + axioms);
+    map->steps = (const proofbin_step_t *)(p + steps);
+    return 0;
+}
+
+int ProofBin_Map(const char *path, proofbin_map_t *map)
+{
+    memset(map, 0, sizeof(proofbin_map_t));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(proofbin_header_t)) {
+        close(fd);
+        return -1;
+    }
+
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+
+    map->base = base;
+    map->size = st.st_size;
+
+    if (ProofBin_View(base, st.st_size, map) != 0) {
+        ProofBin_Unmap(map);
+        return -1;
+    }
+    return 0;
+}
+
+void ProofBin_Unmap(proofbin_map_t *map)
+{
+    if (map->base != NULL) munmap(map->base, map->size);
+    memset(map, 0, sizeof(proofbin_map_t));
+}
+
+static bool ValidNode(proofbin_map_t *map, uint32_t id)
+{
+    return id < map->header->node_count;
+}
+
+/*
+ * Rebuilds the node table as expressions. Nodes only refer to earlier
+ * nodes, so equal subformulas end up as one shared expression and the
+ * result is already interned.
+ */
+int ProofBin_Load(proofbin_map_t *map, proof_t *proof)
+{
+    const proofbin_header_t *h = map->header;
+    expr_t **exprs = malloc((h->node_count ? h->node_count : 1) * sizeof(expr_t *));
+    int res = -1;
+
+    for (uint32_t i = 0; i < h->node_count; i++) {
+        const proofbin_node_t *node = &map->nodes[i];
+
+        switch (node->type) {
+        case EXPR_IMPLIES:
+            if (node->a >= i || node->b >= i) goto done;
+            exprs[i] = Expr_Implies(exprs[node->a], exprs[node->b]);
+            break;
+        case EXPR_NOT:
+            if (node->a >= i) goto done;
+            exprs[i] = Expr_Not(exprs[node->a]);
+            break;
+        case EXPR_ATOM: {
+            if (node->a >= h->atom_count) goto done;
+            const proofbin_atom_t *atom = &map->atoms[node->a];
+            char name[16];
+            if (atom->len == 0 || atom->len >= sizeof(name) ||
+                (uint64_t)atom->offset + atom->len > h->strtab_size) goto done;
+            memcpy(name, map->strtab + atom->offset, atom->len);
+            name[atom->len] = '\0';
+            exprs[i] = Expr_Atom(name);
+            break;
+        }
+        default:
+            goto done;
+        }
+    }
+
+    for (uint32_t i = 0; i < h->axiom_count; i++) {
+        if (!ValidNode(map, map->axioms[i])) goto done;
+    }
+
+    for (uint32_t i = 0; i < h->step_count; i++) {
+        const proofbin_step_t *in = &map->steps[i];
+        proof_step_t step;
+
+        if (!ValidNode(map, in->formula)) goto done;
+        step.e = exprs[in->formula];
+        step.type = in->type;
+
+        switch (in->type) {
+        case INFERENCE_AXIOM:
+            if (in->args[0] >= h->axiom_count) goto done;
+            step.axiom.axiom = exprs[map->axioms[in->args[0]]];
+            for (int j = 1; j < 4; j++) {
+                if (in->args[j] != PROOFBIN_NONE && !ValidNode(map, in->args[j])) goto done;
+            }
+            step.axiom.A = in->args[1] != PROOFBIN_NONE ? exprs[in->args[1]] : NULL;
+            step.axiom.B = in->args[2] != PROOFBIN_NONE ? exprs[in->args[2]] : NULL;
+            step.axiom.C = in->args[3] != PROOFBIN_NONE ? exprs[in->args[3]] : NULL;
+            break;
+        case INFERENCE_MODUS_PONENS:
+            if (in->args[0] >= h->step_count || in->args[1] >= h->step_count) goto done;
+            step.modus_ponens.A_impl_B = in->args[0];
+            step.modus_ponens.A = in->args[1];
+            break;
+        case INFERENCE_DEDUCTION:
+            break;
+        default:
+            goto done;
+        }
+
+        Proof_Push(proof, &step);
+    }
+    res = 0;
+
+done:
+    free(exprs);
+    return res;
+}
@@ -0,0 +1,78 @@
+#ifndef PROOFBIN_H
+#define PROOFBIN_H
+
+#include "proof.h"
+#include "writer.h"
+#include <stdint.h>
+
+/*
+ * Binary proof format. Every section is an array of 32-bit words in host
+ * (little-endian) order and starts 4-byte aligned, so a mapped file can be
+ * read in place. Sections follow the header back to back:
+ *
+ *   atoms   atom_count  x { offset, len } into strtab
+ *   strtab  strtab_size bytes of atom names, padded to 4
+ *   nodes   node_count  x { type, a, b }, children before parents
+ *   axioms  axiom_count x node id of the schema
+ *   steps   step_count  x { type, formula, args[4] }
+ *
+ * Axiom steps store { axiom index, A, B, C } in args, MP steps store
+ * { major step, minor step }. Every formula, schema and binding is a node
+ * id, and equal formulas share one node.
+ */
+
+#define PROOFBIN_MAGIC   "MPPROOF"
+#define PROOFBIN_VERSION 1
+#define PROOFBIN_NONE    UINT32_MAX
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t atom_count;
+    uint32_t node_count;
+    uint32_t axiom_count;
+    uint32_t step_count;
+    uint32_t goal;
+    uint32_t strtab_size;
+    uint32_t reserved[7];
+} proofbin_header_t;
+
+typedef struct {
+    uint32_t offset;
+    uint32_t len;
+} proofbin_atom_t;
+
+typedef struct {
+    uint32_t type;
+    uint32_t a;
+    uint32_t b;
+} proofbin_node_t;
+
+typedef struct {
+    uint32_t type;
+    uint32_t formula;
+    uint32_t args[4];
+} proofbin_step_t;
+
+typedef struct {
+    void *base;
+    size_t size;
+
+    const proofbin_header_t *header;
+    const proofbin_atom_t *atoms;
+    const char *strtab;
+    const proofbin_node_t *nodes;
+    const uint32_t *axioms;
+    const proofbin_step_t *steps;
+} proofbin_map_t;
+
+void ProofBin_Encode(writer_t *w, proof_t *proof);
+int  ProofBin_Write(const char *path, proof_t *proof);
+
+bool ProofBin_Probe(const char *path);
+int  ProofBin_View(const void *base, size_t size, proofbin_map_t *map);
+int  ProofBin_Map(const char *path, proofbin_map_t *map);
+void ProofBin_Unmap(proofbin_map_t *map);
+int  ProofBin_Load(proofbin_map_t *map, proof_t *proof);
+
+#endif
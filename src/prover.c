@@ -0,0 +1,919 @@
+#include "prover.h"
+#include "canon.h"
+#include "parser.h"
+#include "poolimage.h"
+#include "source.h"
+#include "trace.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NOT_FOUND -1
+
+typedef struct {
+    expr_t *e;
+    int negate;
+    int state;
+} walk_frame_t;
+
+/* Adds every subformula as a term, children before parents. */
+static void ExtractSubformulas(expr_t* e, int negate)
+{
+    walk_frame_t local[64];
+    walk_frame_t *stack = local;
+    int sp = 0, cap = 64;
+    stack[sp++] = (walk_frame_t){ e, negate, 0 };
+
+    while (sp > 0) {
+        walk_frame_t *f = &stack[sp - 1];
+        e = f->e;
+        negate = f->negate;
+
+        if (f->state == 0) {
+            f->state = 1;
+            if (sp + 2 > cap) stack = Expr_GrowStack(stack, local, &cap, sizeof(walk_frame_t));
+
+            switch (e->type) {
+            case EXPR_ATOM:
+                break;
+            case EXPR_IMPLIES:
+                stack[sp++] = (walk_frame_t){ e->implies.b, negate, 0 };
+                stack[sp++] = (walk_frame_t){ e->implies.a, negate, 0 };
+                break;
+            case EXPR_NOT:
+                stack[sp++] = (walk_frame_t){ e->not.a, !negate, 0 };
+                break;
+            default:
+                ASSERT(0, "Unknown expression type");
+                break;
+            }
+            continue;
+        }
+
+        if (negate) AddTerm(Expr_Not(e));
+        else AddTerm(e);
+        sp--;
+    }
+
+    if (stack != local) free(stack);
+}
+
+/* The dump request this thread last answered, see stats_dump_requests. */
+static _Thread_local int dump_seen;
+
+/* Writes the counters of the running search and where it is to stderr. */
+static void DumpSnapshot(prover_ctx_t *ctx)
+{
+    search_t *s = &ctx->search;
+    dump_seen = atomic_load_explicit(&stats_dump_requests, memory_order_relaxed);
+
+    writer_t err;
+    Writer_Init(&err, 2);
+    Writer_Str(&err, "SNAPSHOT: ");
+    Writer_Expr(&err, ctx->goal);
+    Writer_Char(&err, '\n');
+    if (s->phase == SEARCH_INSTANTIATE) {
+        Writer_Str(&err, "    instantiating template ");
+        Writer_Int(&err, s->template + 1, 0);
+        Writer_Str(&err, " of ");
+        Writer_Int(&err, s->template_count, 0);
+    }
+    else {
+        Writer_Str(&err, "    inference pass ");
+        Writer_Int(&err, s->cycle, 0);
+    }
+    Writer_Str(&err, ", pool ");
+    Writer_Int(&err, pool_map_size(&pool), 0);
+    Writer_Str(&err, ", terms ");
+    Writer_Int(&err, terms_set_size(&terms), 0);
+    Writer_Str(&err, ", arena ");
+    Writer_Int(&err, Expr_ArenaUsed(), 0);
+    Writer_Char(&err, '\n');
+    Stats_Write(&ctx->stats, s->templates, s->template_count, &err);
+    Writer_Free(&err);
+}
+
+#define POLL_DUMP(ctx) \
+    if (atomic_load_explicit(&stats_dump_requests, memory_order_relaxed) != dump_seen) DumpSnapshot(ctx)
+
+/* Room kept in the arena for the step that runs past the limit. */
+#define ARENA_MARGIN 100000
+
+#define TIME_CHECK_INTERVAL 1024
+
+/*
+ * Checks the +max-time, +max-exprs and +max-pool budgets of the search.
+ * The clock is read every TIME_CHECK_INTERVAL calls only.
+ */
+static bool OutOfBudget(prover_ctx_t *ctx)
+{
+    search_t *s = &ctx->search;
+
+    if (Expr_ArenaUsed() >= s->max_exprs) {
+        s->aborted = s->max_exprs < ARENA_SIZE - ARENA_MARGIN ? "max-exprs" : "arena full";
+    }
+    else if (ctx->opts.max_pool > 0 && (long)pool_map_size(&pool) >= ctx->opts.max_pool) {
+        s->aborted = "max-pool";
+    }
+    else if (ctx->opts.max_time_ms > 0 && ++s->checks % TIME_CHECK_INTERVAL == 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > s->deadline.tv_sec ||
+            (now.tv_sec == s->deadline.tv_sec && now.tv_nsec >= s->deadline.tv_nsec)) {
+            s->aborted = "max-time";
+        }
+    }
+    return s->aborted != NULL;
+}
+
+/*
+ * Adds the instances of every template over the goal's terms to the pool,
+ * substituting terms i, j, k for A, B, C with k varying fastest, at one
+ * unit of budget per instance. Returns false if the budget ran out first; the position is
+ * kept in the search state, and the terms don't change in between.
+ */
+static bool InstantiateAxioms(prover_ctx_t *ctx, long *budget)
+{
+    search_t *s = &ctx->search;
+
+    while (s->template < s->template_count) {
+        expr_t *ax = s->templates[s->template];
+
+        if (!s->in_template) {
+            if (ctx->opts.print_axioms) {
+                Writer_Str(&out, "Axiom: ");
+                Writer_Expr(&out, ax);
+                Writer_Char(&out, '\n');
+            }
+            s->it_i = s->it_j = s->it_k = terms_set_first(&terms);
+            s->in_template = true;
+        }
+
+        trace_span_t span;
+        Trace_Begin(&span);
+        long added = Stats_Template(&ctx->stats, s->template)->instances;
+
+        while (!terms_set_is_end(s->it_i)) {
+            if (*budget <= 0 || OutOfBudget(ctx)) {
+                Trace_End(&span, "instantiate", ax, Stats_Template(&ctx->stats, s->template)->instances - added);
+                return false;
+            }
+            (*budget)--;
+            POLL_DUMP(ctx);
+
+            expr_t *A = s->it_i.data->key;
+            expr_t *B = s->it_j.data->key;
+            expr_t *C = s->it_k.data->key;
+
+            expr_t *instance = Expr_Substitute(ax, A, B, C);
+            stats_template_t *st = Stats_Template(&ctx->stats, s->template);
+
+            if (FindExprInTerms(instance) == NULL) {
+                size_t size = pool_map_size(&pool);
+                true_expr_t te;
+                TrueExpr_Init(&te, instance);
+                TrueExpr_Axiom(&te, ax, A, B, C);
+                AddToPool(&te);
+                if (ctx->opts.print_axioms) PrintAxiom(&out, te.e, &te.axiom, te.idx);
+                if (pool_map_size(&pool) > size) st->instances++;
+                else st->duplicates++;
+            }
+            else {
+                Expr_Free(instance);
+                st->duplicates++;
+            }
+
+            s->it_k = terms_set_next(s->it_k);
+            if (terms_set_is_end(s->it_k)) {
+                s->it_k = terms_set_first(&terms);
+                s->it_j = terms_set_next(s->it_j);
+                if (terms_set_is_end(s->it_j)) {
+                    s->it_j = terms_set_first(&terms);
+                    s->it_i = terms_set_next(s->it_i);
+                }
+            }
+        }
+
+        Trace_End(&span, "instantiate", ax, Stats_Template(&ctx->stats, s->template)->instances - added);
+        s->template++;
+        s->in_template = false;
+    }
+    return true;
+}
+
+/*
+ * Forward search by MP and the enabled rules. At most two passes are made
+ * over the pool, and a pass restarts from the first entry after every
+ * insert, since inserting may move entries. Each visited entry costs one
+ * unit of budget. Returns false if the budget ran out first; the position
+ * is kept in the search state.
+ */
+static bool RunInference(prover_ctx_t *ctx, expr_t* goal, long *budget)
+{
+    search_t *s = &ctx->search;
+    rules_t *rules = &ctx->rules;
+
+    trace_span_t span;
+    Trace_Begin(&span);
+
+    for (;;) {
+        if (!s->in_pass) {
+            if (!s->new_found || s->goal_found || s->cycle >= 2) return true;
+            s->new_found = 0;
+            s->cycle++;
+            s->it = pool_map_first(&pool);
+            s->in_pass = true;
+            ctx->stats.passes++;
+            Trace_Begin(&span);
+        }
+        if (pool_map_is_end(s->it) || s->goal_found) {
+            s->in_pass = false;
+            Trace_End(&span, "saturate", goal, s->cycle);
+            continue;
+        }
+
+        if (*budget <= 0 || OutOfBudget(ctx)) {
+            Trace_End(&span, "saturate", goal, s->cycle);
+            return false;
+        }
+        (*budget)--;
+        POLL_DUMP(ctx);
+
+        expr_t *A_impl_B = s->it.data->val.e;
+
+        if (A_impl_B->type != EXPR_IMPLIES) {
+            s->it = pool_map_next(s->it);
+            continue;
+        }
+
+        true_expr_t derived;
+        if (rules->enabled && Rules_Fire(rules, A_impl_B, &derived)) {
+            AddToPool(&derived);
+            Rules_Index(rules, derived.e);
+            s->it = pool_map_first(&pool);
+            s->new_found = 1;
+            ctx->stats.rule_firings++;
+            ctx->stats.restarts++;
+
+            if (Expr_Equal(derived.e, goal)) {
+                if (ctx->opts.announce) Writer_Str(&out, "GOAL FOUND!\n");
+                s->goal_found = 1;
+            }
+            continue;
+        }
+
+        expr_t *A = A_impl_B->implies.a;
+        expr_t *B = A_impl_B->implies.b;
+        ctx->stats.mp_attempts++;
+
+        true_expr_t *B_te = FindExprInPool(B);
+        if (B_te != NULL) {
+            true_expr_t *A_impl_B_te = &s->it.data->val;
+            if (pool_record_derivations && !A_impl_B_te->mp_recorded && FindExprInPool(A) != NULL) {
+                true_expr_t te;
+                TrueExpr_Init(&te, B);
+                TrueExpr_ModusPonens(&te, A_impl_B, A);
+                AddAlternative(B_te, &te);
+                A_impl_B_te->mp_recorded = true;
+            }
+            s->it = pool_map_next(s->it);
+            continue;
+        }
+
+        true_expr_t *A_te = FindExprInPool(A);
+        if (A_te != NULL) {
+            true_expr_t te;
+            TrueExpr_Init(&te, B);
+            TrueExpr_ModusPonens(&te, A_impl_B, A);
+            s->it.data->val.mp_recorded = true;
+            AddToPool(&te); // iterator gets invalidated.... :(((
+            Rules_Index(rules, B);
+            s->it = pool_map_first(&pool);
+            s->new_found = 1;
+            ctx->stats.mp_successes++;
+            ctx->stats.restarts++;
+
+            if (Expr_Equal(B, goal)) {
+                if (ctx->opts.announce) Writer_Str(&out, "GOAL FOUND!\n");
+                s->goal_found = 1;
+            }
+            continue;
+        }
+
+        s->it = pool_map_next(s->it);
+    }
+}
+
+int ReadAxioms(const char *filename, expr_t ***axioms)
+{
+    source_t src;
+    if (Source_Open(&src, filename) != 0) {
+        return -1;
+    }
+
+    int count = 0, capacity = 16;
+    *axioms = malloc(capacity * sizeof(expr_t *));
+
+    const char *begin, *end;
+    while (Source_NextLine(&src, &begin, &end)) {
+        if (Source_SkipLine(begin, end)) {
+            continue;
+        }
+
+        parser_t parser;
+        Parser_InitRange(&parser, begin, end);
+        if (count == capacity) {
+            capacity *= 2;
+            *axioms = realloc(*axioms, capacity * sizeof(expr_t *));
+        }
+        (*axioms)[count++] = Parser_ReadExpr(&parser);
+    }
+
+    Source_Close(&src);
+    return count;
+}
+
+static void CollectTerms(prover_ctx_t *ctx, expr_t *goal)
+{
+    ExtractSubformulas(goal, 0);
+    if (ctx->opts.add_neg_terms) ExtractSubformulas(goal, 1);
+
+    if (ctx->opts.add_self_impl) {
+        expr_t* self_impl = Expr_Implies(goal, goal);
+        AddTerm(self_impl);
+    }
+}
+
+/* The axioms followed by the derived schemas, in a new array. */
+static expr_t **Templates(prover_ctx_t *ctx, int *count)
+{
+    *count = ctx->axiom_count + ctx->schemas->count;
+    expr_t **templates = malloc((*count + 1) * sizeof(expr_t *));
+    memcpy(templates, ctx->axioms, ctx->axiom_count * sizeof(expr_t *));
+    for (int i = 0; i < ctx->schemas->count; i++) {
+        templates[ctx->axiom_count + i] = ctx->schemas->items[i].schema;
+    }
+    return templates;
+}
+
+/* Adds the lemma steps from LemmaDb_Seed to the pool; no lock is needed, the pool is the thread's. */
+static void SeedPool(proof_t *lemmas)
+{
+    for (int i = 0; i < lemmas->count; i++) {
+        proof_step_t *step = &lemmas->steps[i];
+        if (FindExprInPool(step->e) != NULL) continue;
+
+        true_expr_t te;
+        TrueExpr_Init(&te, step->e);
+        if (step->type == INFERENCE_AXIOM) {
+            TrueExpr_Axiom(&te, step->axiom.axiom, step->axiom.A, step->axiom.B, step->axiom.C);
+        }
+        else {
+            TrueExpr_ModusPonens(&te, lemmas->steps[step->modus_ponens.A_impl_B].e,
+                                      lemmas->steps[step->modus_ponens.A].e);
+        }
+        AddToPool(&te);
+    }
+}
+
+static void SaveSearchImage(prover_ctx_t *ctx)
+{
+    search_t *s = &ctx->search;
+    pthread_mutex_lock(ctx->lock);
+    if (PoolImage_Save(ctx->opts.save_pool_path, s->fingerprint, &s->canon, s->templates, s->template_count) != 0) {
+        fprintf(stderr, "failed to write %s\n", ctx->opts.save_pool_path);
+        *ctx->write_failed = true;
+    }
+    pthread_mutex_unlock(ctx->lock);
+}
+
+/*
+ * Sets up the search for the goal: the templates are the axioms and the
+ * derived schemas, and the pool comes from a pool image if one matches,
+ * otherwise it is instantiated by the first steps.
+ */
+static void StartSearch(prover_ctx_t *ctx)
+{
+    search_t *s = &ctx->search;
+    memset(s, 0, sizeof(search_t));
+    s->templates = Templates(ctx, &s->template_count);
+
+    s->max_exprs = ARENA_SIZE - ARENA_MARGIN;
+    if (ctx->opts.max_exprs > 0 && ctx->opts.max_exprs < s->max_exprs) s->max_exprs = ctx->opts.max_exprs;
+    clock_gettime(CLOCK_MONOTONIC, &s->deadline);
+    s->deadline.tv_sec += ctx->opts.max_time_ms / 1000;
+    s->deadline.tv_nsec += ctx->opts.max_time_ms % 1000 * 1000000;
+    if (s->deadline.tv_nsec >= 1000000000) {
+        s->deadline.tv_sec++;
+        s->deadline.tv_nsec -= 1000000000;
+    }
+
+    Canon_Init(&s->canon);
+    Canon_Build(&s->canon, ctx->goal);
+    Canon_Invert(&s->canon, &s->inverse);
+
+    const char *load_pool_path = ctx->opts.load_pool_path;
+    if (load_pool_path != NULL || ctx->opts.save_pool_path != NULL) {
+        s->fingerprint = PoolImage_Fingerprint(&s->canon, s->templates, s->template_count);
+    }
+
+    s->phase = SEARCH_INSTANTIATE;
+    if (load_pool_path != NULL && PoolImage_Load(load_pool_path, s->fingerprint, &s->inverse) == 0) {
+        s->template = s->template_count;
+        s->loaded = true;
+    }
+}
+
+static void EndSearch(prover_ctx_t *ctx)
+{
+    search_t *s = &ctx->search;
+    if (s->phase == SEARCH_IDLE) return;
+
+    Canon_Free(&s->canon);
+    Canon_Free(&s->inverse);
+    free(s->templates);
+    memset(s, 0, sizeof(search_t));
+}
+
+static void UpdatePeaks(prover_ctx_t *ctx)
+{
+    prover_stats_t *st = &ctx->stats;
+    if (Expr_ArenaUsed() > st->peak_exprs) st->peak_exprs = Expr_ArenaUsed();
+    if ((long)pool_map_size(&pool) > st->peak_pool) st->peak_pool = pool_map_size(&pool);
+}
+
+/* Status of a search that stopped early: out of slice, or out of budget. */
+static prover_status_t Suspend(prover_ctx_t *ctx)
+{
+    if (ctx->search.aborted == NULL) return PROVER_RUNNING;
+
+    UpdatePeaks(ctx);
+    ctx->stats.aborted++;
+    return PROVER_ABORTED;
+}
+
+/*
+ * Advances the search by at most budget units and finishes it once the
+ * goal is found or the pool is exhausted: the proof is extracted, macro
+ * steps are expanded and the lemma is stored.
+ */
+static prover_status_t StepSearch(prover_ctx_t *ctx, long budget)
+{
+    search_t *s = &ctx->search;
+    expr_t *goal = ctx->goal;
+
+    stats_clock_t clock;
+    Stats_Start(&clock);
+
+    if (s->phase == SEARCH_INSTANTIATE) {
+        if (!InstantiateAxioms(ctx, &budget)) {
+            Stats_Stop(&ctx->stats, PHASE_INSTANTIATE, &clock);
+            return Suspend(ctx);
+        }
+
+        if (!s->loaded && ctx->opts.save_pool_path != NULL) SaveSearchImage(ctx);
+        if (ctx->db != NULL) {
+            proof_t lemmas;
+            Proof_Init(&lemmas);
+            pthread_mutex_lock(ctx->lock);
+            LemmaDb_Seed(ctx->db, goal, ctx->axioms, ctx->axiom_count, &lemmas);
+            pthread_mutex_unlock(ctx->lock);
+            SeedPool(&lemmas);
+            Proof_Free(&lemmas);
+        }
+
+        rules_t *rules = &ctx->rules;
+        for (pool_map_itr it = pool_map_first(&pool); rules->enabled && !pool_map_is_end(it); it = pool_map_next(it)) {
+            Rules_Index(rules, it.data->val.e);
+        }
+        s->new_found = 1;
+        s->phase = SEARCH_INFER;
+        Stats_Stop(&ctx->stats, PHASE_INSTANTIATE, &clock);
+        Stats_Start(&clock);
+    }
+
+    bool done = RunInference(ctx, goal, &budget);
+    Stats_Stop(&ctx->stats, PHASE_INFERENCE, &clock);
+    if (!done) return Suspend(ctx);
+    UpdatePeaks(ctx);
+
+    true_expr_t *res = FindExprInPool(goal);
+    EndSearch(ctx);
+    if (res == NULL) return PROVER_NOT_FOUND;
+
+    trace_span_t span;
+    Trace_Begin(&span);
+    Stats_Start(&clock);
+
+    if (ctx->opts.shortest_proof) Pool_SelectCheapest(ctx->opts.proof_metric);
+    Proof_Extract(&ctx->proof, res);
+    Rules_Expand(&ctx->rules, &ctx->proof);
+    Schema_Expand(ctx->schemas, &ctx->proof);
+    if (ctx->db != NULL) {
+        pthread_mutex_lock(ctx->lock);
+        if (LemmaDb_Add(ctx->db, &ctx->proof) != 0) {
+            fprintf(stderr, "failed to update lemma database %s\n", ctx->opts.lemma_db_path);
+            *ctx->write_failed = true;
+        }
+        pthread_mutex_unlock(ctx->lock);
+    }
+    Stats_Stop(&ctx->stats, PHASE_PROOF, &clock);
+    Trace_End(&span, "proof", goal, ctx->proof.count);
+    return PROVER_FOUND;
+}
+
+/* Installs the context's per-goal state on the calling thread, or takes it down again. */
+static void Swap(prover_ctx_t *ctx)
+{
+    Expr_SwapArena(&ctx->arena);
+    Pool_Swap(&ctx->pool);
+}
+
+void Prover_DefaultOptions(prover_options_t *opts)
+{
+    memset(opts, 0, sizeof(prover_options_t));
+    opts->proof_metric = PROOF_METRIC_SIZE;
+    opts->announce = 1;
+}
+
+static prover_ctx_t *Alloc(const prover_options_t *opts)
+{
+    prover_ctx_t *ctx = calloc(1, sizeof(prover_ctx_t));
+    if (ctx == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    ctx->opts = *opts;
+    Pool_InitState(&ctx->pool, opts->shortest_proof);
+    Proof_Init(&ctx->proof);
+    Stats_Init(&ctx->stats);
+    return ctx;
+}
+
+prover_ctx_t *Prover_Create(const prover_options_t *opts)
+{
+    prover_ctx_t *ctx = Alloc(opts);
+    Schema_Init(&ctx->own_schemas);
+    pthread_mutex_init(&ctx->own_lock, NULL);
+    ctx->schemas = &ctx->own_schemas;
+    ctx->lock = &ctx->own_lock;
+    ctx->write_failed = &ctx->own_write_failed;
+    Rules_Init(&ctx->rules, 0, NULL, 0);
+    return ctx;
+}
+
+/*
+ * A context with the options, axioms, lemma database and schemas of
+ * parent, which must have its axioms loaded and must outlive it.
+ */
+prover_ctx_t *Prover_CreateShared(prover_ctx_t *parent)
+{
+    return Prover_CreateVariant(parent, &parent->opts);
+}
+
+/*
+ * Like Prover_CreateShared, but searching with opts. The lemma database
+ * and schemas are still the parent's.
+ */
+prover_ctx_t *Prover_CreateVariant(prover_ctx_t *parent, const prover_options_t *opts)
+{
+    prover_ctx_t *ctx = Alloc(opts);
+    ctx->parent = parent;
+    ctx->axioms = parent->axioms;
+    ctx->axiom_count = parent->axiom_count;
+    ctx->db = parent->db;
+    ctx->schemas = parent->schemas;
+    ctx->lock = parent->lock;
+    ctx->write_failed = parent->write_failed;
+
+    if (opts->enabled_rules == parent->opts.enabled_rules) {
+        Rules_InitFrom(&ctx->rules, &parent->rules);
+    }
+    else {
+        Swap(ctx);
+        Rules_Init(&ctx->rules, opts->enabled_rules, ctx->axioms, ctx->axiom_count);
+        ctx->mark = Expr_Mark();
+        Swap(ctx);
+    }
+    return ctx;
+}
+
+void Prover_Destroy(prover_ctx_t *ctx)
+{
+    EndSearch(ctx);
+    Proof_Free(&ctx->proof);
+    Stats_Free(&ctx->stats);
+    Rules_Free(&ctx->rules);
+    Pool_FreeState(&ctx->pool);
+
+    if (ctx->parent == NULL) {
+        if (ctx->db != NULL) LemmaDb_Close(ctx->db);
+        Schema_Free(&ctx->own_schemas);
+        pthread_mutex_destroy(&ctx->own_lock);
+        free(ctx->axioms);
+    }
+
+    Expr_SwapArena(&ctx->arena);
+    Expr_FreeArena();
+    Expr_SwapArena(&ctx->arena);
+    free(ctx);
+}
+
+/*
+ * Reads the axioms, enables the derived rules they support and opens the
+ * lemma database, deriving schemas from it if asked to. Returns the number
+ * of axioms, or -1 if the file can't be read.
+ */
+int Prover_LoadAxioms(prover_ctx_t *ctx, const char *path)
+{
+    if (ctx->parent != NULL || ctx->axioms != NULL) return -1;
+
+    Swap(ctx);
+    ctx->axiom_count = ReadAxioms(path, &ctx->axioms);
+    if (ctx->axiom_count < 0) {
+        ctx->axioms = NULL;
+        Swap(ctx);
+        return -1;
+    }
+
+    Rules_Free(&ctx->rules);
+    Rules_Init(&ctx->rules, ctx->opts.enabled_rules, ctx->axioms, ctx->axiom_count);
+
+    if (ctx->opts.lemma_db_path != NULL) {
+        if (LemmaDb_Open(&ctx->own_db, ctx->opts.lemma_db_path) == 0) {
+            ctx->db = &ctx->own_db;
+        }
+        else {
+            fprintf(stderr, "failed to open lemma database %s\n", ctx->opts.lemma_db_path);
+        }
+    }
+    if (ctx->db != NULL && ctx->opts.derive_schemas) {
+        LemmaDb_Schemas(ctx->db, ctx->axioms, ctx->axiom_count, ctx->schemas);
+    }
+
+    ctx->mark = Expr_Mark();
+    Swap(ctx);
+    return ctx->axiom_count;
+}
+
+/* Parses the goal on [begin, end) and collects its terms. */
+expr_t *Prover_SetGoal(prover_ctx_t *ctx, const char *begin, const char *end)
+{
+    prover_stats_t *st = &ctx->stats;
+    stats_clock_t clock;
+
+    Swap(ctx);
+    Stats_Start(&clock);
+    parser_t parser;
+    Parser_InitRange(&parser, begin, end);
+    ctx->goal = Parser_ReadExpr(&parser);
+    Stats_Stop(st, PHASE_PARSE, &clock);
+
+    Stats_Start(&clock);
+    CollectTerms(ctx, ctx->goal);
+    Stats_Stop(st, PHASE_TERMS, &clock);
+
+    st->goals++;
+    st->terms += terms_set_size(&terms);
+    if ((long)terms_set_size(&terms) > st->peak_terms) st->peak_terms = terms_set_size(&terms);
+    Swap(ctx);
+    return ctx->goal;
+}
+
+void Prover_PrintTerms(prover_ctx_t *ctx, writer_t *w)
+{
+    Swap(ctx);
+    Writer_Str(w, "TERMS:\n");
+    for (terms_set_itr it = terms_set_first(&terms); !terms_set_is_end(it); it = terms_set_next(it)) {
+        Writer_Str(w, "    "); Writer_Expr(w, it.data->key); Writer_Char(w, '\n');
+    }
+    Writer_Char(w, '\n');
+    Swap(ctx);
+}
+
+/*
+ * Looks the goal up in the lemma database and, if it is not there, sets up
+ * the search that Prover_Step advances.
+ */
+prover_status_t Prover_Start(prover_ctx_t *ctx)
+{
+    if (ctx->goal == NULL || ctx->axioms == NULL) return ctx->status = PROVER_NOT_FOUND;
+
+    stats_clock_t clock;
+    Stats_Start(&clock);
+    trace_span_t span;
+    Trace_Begin(&span);
+
+    Swap(ctx);
+    bool found = false;
+    if (ctx->db != NULL) {
+        pthread_mutex_lock(ctx->lock);
+        found = LemmaDb_Find(ctx->db, ctx->goal, ctx->axioms, ctx->axiom_count, &ctx->proof) == 0;
+        pthread_mutex_unlock(ctx->lock);
+    }
+
+    if (found) {
+        if (ctx->opts.announce) Writer_Str(&out, "GOAL FOUND IN LEMMA DATABASE!\n");
+        ctx->status = PROVER_FOUND;
+        ctx->stats.found++;
+    }
+    else {
+        StartSearch(ctx);
+        ctx->status = PROVER_RUNNING;
+    }
+    Trace_End(&span, "lookup", ctx->goal, -1);
+    Swap(ctx);
+
+    Stats_Stop(&ctx->stats, PHASE_LOOKUP, &clock);
+    return ctx->status;
+}
+
+/*
+ * Runs the search for at most budget units (an axiom instance or a visited
+ * pool entry each) and returns. A scheduler calls this in turns to share
+ * threads between many goals; a context can be resumed on any thread.
+ */
+prover_status_t Prover_Step(prover_ctx_t *ctx, long budget)
+{
+    if (ctx->status != PROVER_RUNNING) return ctx->status;
+
+    trace_span_t span;
+    Trace_Begin(&span);
+
+    Swap(ctx);
+    ctx->status = StepSearch(ctx, budget);
+    if (ctx->status == PROVER_FOUND) ctx->stats.found++;
+    Trace_End(&span, "step", ctx->goal, -1);
+    Swap(ctx);
+    return ctx->status;
+}
+
+/* Runs Prover_Start and Prover_Step to the end. */
+bool Prover_Prove(prover_ctx_t *ctx)
+{
+    prover_status_t status = Prover_Start(ctx);
+    while (status == PROVER_RUNNING) {
+        status = Prover_Step(ctx, LONG_MAX);
+    }
+    return status == PROVER_FOUND;
+}
+
+/* The proof found by the last Prover_Prove, or NULL. Valid until the next reset. */
+proof_t *Prover_Proof(prover_ctx_t *ctx)
+{
+    return ctx->status == PROVER_FOUND ? &ctx->proof : NULL;
+}
+
+/*
+ * Writes the result of the last Prover_Prove as one record,
+ *
+ *   GOAL <n> PROVED: <steps> steps, <goal>
+ *   GOAL <n> NOT FOUND: <goal>
+ *
+ * followed by the proof and a blank line if history is set.
+ */
+void Prover_WriteRecord(prover_ctx_t *ctx, writer_t *w, int n, bool history)
+{
+    Writer_Str(w, "GOAL ");
+    Writer_Int(w, n, 0);
+    if (ctx->status == PROVER_FOUND) {
+        Writer_Str(w, " PROVED: ");
+        Writer_Int(w, ctx->proof.count, 0);
+        Writer_Str(w, " steps, ");
+    }
+    else if (ctx->status == PROVER_ABORTED) {
+        Writer_Str(w, " ABORTED: ");
+        Writer_Str(w, ctx->search.aborted);
+        Writer_Str(w, ", ");
+    }
+    else {
+        Writer_Str(w, " NOT FOUND: ");
+    }
+    Writer_Expr(w, ctx->goal);
+    Writer_Char(w, '\n');
+
+    if (ctx->status == PROVER_FOUND && history) {
+        Proof_Print(w, &ctx->proof);
+        Writer_Char(w, '\n');
+    }
+    if (ctx->status == PROVER_ABORTED && history) {
+        Prover_WritePartial(ctx, w);
+    }
+}
+
+/* The record of goal n when it does not parse; expected is what Parser_Check reported. */
+void Prover_WriteErrorRecord(writer_t *w, int n, const char *expected)
+{
+    Writer_Str(w, "GOAL ");
+    Writer_Int(w, n, 0);
+    Writer_Str(w, " ERROR: expected ");
+    Writer_Str(w, expected);
+    Writer_Char(w, '\n');
+}
+
+#define MAX_OPEN_SUBGOALS 10
+
+/*
+ * Reports how far an aborted search got: the phase it stopped in, how much
+ * of the current pass over the pool was done, and the open subgoals, the
+ * antecedents X of pool entries X => goal that are not derived yet.
+ */
+void Prover_WritePartial(prover_ctx_t *ctx, writer_t *w)
+{
+    if (ctx->status != PROVER_ABORTED) return;
+
+    Swap(ctx);
+    search_t *s = &ctx->search;
+    Writer_Str(w, "SEARCH ABORTED: ");
+    Writer_Str(w, s->aborted);
+    Writer_Char(w, '\n');
+
+    if (s->phase == SEARCH_INSTANTIATE) {
+        Writer_Str(w, "    instantiated ");
+        Writer_Int(w, s->template, 0);
+        Writer_Str(w, " of ");
+        Writer_Int(w, s->template_count, 0);
+        Writer_Str(w, " templates\n");
+    }
+    else {
+        long visited = 0;
+        for (pool_map_itr it = pool_map_first(&pool); s->in_pass && !pool_map_is_end(it); it = pool_map_next(it)) {
+            if (it.data == s->it.data) break;
+            visited++;
+        }
+        Writer_Str(w, "    inference pass ");
+        Writer_Int(w, s->cycle, 0);
+        Writer_Str(w, ", ");
+        Writer_Int(w, visited, 0);
+        Writer_Str(w, " of ");
+        Writer_Int(w, pool_map_size(&pool), 0);
+        Writer_Str(w, " pool entries visited since the last insert\n");
+    }
+    Writer_Str(w, "    pool ");
+    Writer_Int(w, pool_map_size(&pool), 0);
+    Writer_Str(w, ", terms ");
+    Writer_Int(w, terms_set_size(&terms), 0);
+    Writer_Str(w, ", arena ");
+    Writer_Int(w, Expr_ArenaUsed(), 0);
+    Writer_Char(w, '\n');
+
+    int open = 0;
+    for (pool_map_itr it = pool_map_first(&pool); !pool_map_is_end(it); it = pool_map_next(it)) {
+        expr_t *e = it.data->val.e;
+        if (e->type != EXPR_IMPLIES || !Expr_Equal(e->implies.b, ctx->goal)) continue;
+        if (FindExprInPool(e->implies.a) != NULL) continue;
+
+        if (open++ == MAX_OPEN_SUBGOALS) {
+            Writer_Str(w, "    ...\n");
+            break;
+        }
+        Writer_Str(w, "    open: ");
+        Writer_Expr(w, e->implies.a);
+        Writer_Char(w, '\n');
+    }
+    Writer_Char(w, '\n');
+    Swap(ctx);
+}
+
+/* Drops the goal and everything derived for it; axioms and schemas stay. */
+void Prover_Reset(prover_ctx_t *ctx)
+{
+    Swap(ctx);
+    EndSearch(ctx);
+    Proof_Free(&ctx->proof);
+    Proof_Init(&ctx->proof);
+    Pool_Reset();
+    Rules_Reset(&ctx->rules);
+    Expr_Release(ctx->mark);
+    Swap(ctx);
+
+    ctx->goal = NULL;
+    ctx->status = PROVER_NOT_FOUND;
+}
+
+/*
+ * Writes st, the statistics of ctx or of contexts sharing its axioms, as a
+ * report or as one line of JSON. Templates are named after the axioms and
+ * schemas of ctx.
+ */
+void Prover_WriteStats(prover_ctx_t *ctx, prover_stats_t *st, writer_t *w, bool json)
+{
+    int count;
+    expr_t **templates = Templates(ctx, &count);
+    if (json) Stats_WriteJson(st, templates, count, w);
+    else Stats_Write(st, templates, count, w);
+    free(templates);
+}
+
+/* Whether a pool image or lemma of ctx or of a context sharing its session could not be written. */
+bool Prover_WriteFailed(prover_ctx_t *ctx)
+{
+    pthread_mutex_lock(ctx->lock);
+    bool failed = *ctx->write_failed;
+    pthread_mutex_unlock(ctx->lock);
+    return failed;
+}
@@ -0,0 +1,130 @@
+#ifndef PROVER_H
+#define PROVER_H
+
+#include "canon.h"
+#include "lemmadb.h"
+#include "proof.h"
+#include "rules.h"
+#include "schema.h"
+#include "stats.h"
+#include <pthread.h>
+#include <stdbool.h>
+
+/*
+ * Embeddable prover. A context owns everything a search touches: its
+ * expression arena, pool, term set, rule index and options, so any number
+ * of them can live in one process. The pool code works on the calling
+ * thread's state (see pool.h); every Prover_ call swaps the context's
+ * state in and back out, so a context may move between threads but must
+ * not be used by two threads at once. Diagnostic output (+axioms, the
+ * GOAL FOUND lines) goes to the calling thread's out writer.
+ */
+typedef struct {
+    int print_axioms;
+    int add_neg_terms;
+    int add_self_impl;
+    int shortest_proof;
+    proof_metric_t proof_metric;
+    int derive_schemas;
+    unsigned enabled_rules;
+    int announce;
+    const char *lemma_db_path;
+    const char *save_pool_path;
+    const char *load_pool_path;
+    long max_time_ms;
+    long max_exprs;
+    long max_pool;
+} prover_options_t;
+
+typedef enum {
+    PROVER_RUNNING,
+    PROVER_FOUND,
+    PROVER_NOT_FOUND,
+    PROVER_ABORTED
+} prover_status_t;
+
+typedef enum {
+    SEARCH_IDLE,
+    SEARCH_INSTANTIATE,
+    SEARCH_INFER
+} search_phase_t;
+
+/* Where a suspended search resumes, see Prover_Step. */
+typedef struct {
+    search_phase_t phase;
+
+    expr_t **templates;
+    int template_count;
+    int template;
+    bool in_template;
+    terms_set_itr it_i, it_j, it_k;
+
+    renaming_t canon, inverse;
+    uint64_t fingerprint;
+    bool loaded;
+
+    int cycle;
+    int new_found;
+    int goal_found;
+    bool in_pass;
+    pool_map_itr it;
+
+    struct timespec deadline;
+    long max_exprs;
+    unsigned checks;
+    const char *aborted;
+} search_t;
+
+typedef struct prover_ctx_t {
+    prover_options_t opts;
+
+    /* Set up by Prover_LoadAxioms and shared with Prover_CreateShared contexts. */
+    expr_t **axioms;
+    int axiom_count;
+    lemmadb_t *db;
+    schema_list_t *schemas;
+    pthread_mutex_t *lock;
+    bool *write_failed;
+    struct prover_ctx_t *parent;
+
+    lemmadb_t own_db;
+    schema_list_t own_schemas;
+    pthread_mutex_t own_lock;
+    bool own_write_failed;
+
+    expr_arena_t arena;
+    pool_state_t pool;
+    rules_t rules;
+    expr_mark_t mark;
+
+    expr_t *goal;
+    search_t search;
+    prover_status_t status;
+    proof_t proof;
+    prover_stats_t stats;
+} prover_ctx_t;
+
+void Prover_DefaultOptions(prover_options_t *opts);
+
+prover_ctx_t *Prover_Create(const prover_options_t *opts);
+prover_ctx_t *Prover_CreateShared(prover_ctx_t *parent);
+prover_ctx_t *Prover_CreateVariant(prover_ctx_t *parent, const prover_options_t *opts);
+void Prover_Destroy(prover_ctx_t *ctx);
+
+int  Prover_LoadAxioms(prover_ctx_t *ctx, const char *path);
+expr_t *Prover_SetGoal(prover_ctx_t *ctx, const char *begin, const char *end);
+void Prover_PrintTerms(prover_ctx_t *ctx, writer_t *w);
+prover_status_t Prover_Start(prover_ctx_t *ctx);
+prover_status_t Prover_Step(prover_ctx_t *ctx, long budget);
+bool Prover_Prove(prover_ctx_t *ctx);
+proof_t *Prover_Proof(prover_ctx_t *ctx);
+void Prover_WriteRecord(prover_ctx_t *ctx, writer_t *w, int n, bool history);
+void Prover_WriteErrorRecord(writer_t *w, int n, const char *expected);
+void Prover_WritePartial(prover_ctx_t *ctx, writer_t *w);
+void Prover_Reset(prover_ctx_t *ctx);
+void Prover_WriteStats(prover_ctx_t *ctx, prover_stats_t *st, writer_t *w, bool json);
+bool Prover_WriteFailed(prover_ctx_t *ctx);
+
+int  ReadAxioms(const char *filename, expr_t ***axioms);
+
+#endif
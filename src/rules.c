@@ -0,0 +1,284 @@
+#include "rules.h"
+#include "parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SYLLOGISM_STEPS      5
+#define CONTRAPOSITION_STEPS (3 + SYLLOGISM_STEPS)
+
+static const char *rule_names[RULE_COUNT] = { "syllogism", "contraposition" };
+
+int Rules_Parse(const char *spec, unsigned *enabled)
+{
+    *enabled = 0;
+    if (strcmp(spec, "all") == 0) {
+        *enabled = RULES_ALL;
+        return 0;
+    }
+    if (strcmp(spec, "none") == 0) {
+        return 0;
+    }
+
+    while (*spec != '\0') {
+        size_t len = strcspn(spec, ",");
+        int rule = 0;
+        while (rule < RULE_COUNT &&
+               (strlen(rule_names[rule]) != len || strncmp(rule_names[rule], spec, len) != 0)) rule++;
+        if (rule == RULE_COUNT) return -1;
+
+        *enabled |= 1u << rule;
+        spec += len;
+        if (*spec == ',') spec++;
+    }
+    return 0;
+}
+
+static expr_t *FindAxiom(const char *schema, expr_t **axioms, int axiom_count)
+{
+    parser_t parser;
+    Parser_Init(&parser, schema);
+    expr_t *e = Parser_ReadExpr(&parser);
+
+    expr_t *res = NULL;
+    for (int i = 0; i < axiom_count && res == NULL; i++) {
+        if (Expr_Equal(axioms[i], e)) res = axioms[i];
+    }
+
+    Expr_Free(e);
+    return res;
+}
+
+void Rules_Init(rules_t *rules, unsigned enabled, expr_t **axioms, int axiom_count)
+{
+    memset(rules, 0, sizeof(rules_t));
+    antecedent_map_init(&rules->antecedents);
+
+    if (enabled == 0) return;
+
+    rules->k = FindAxiom("(A => (B => A))", axioms, axiom_count);
+    rules->s = FindAxiom("((A => (B => C)) => ((A => B) => (A => C)))", axioms, axiom_count);
+    rules->n = FindAxiom("((!B => !A) => ((!B => A) => B))", axioms, axiom_count);
+
+    bool has[RULE_COUNT];
+    has[RULE_SYLLOGISM] = rules->k != NULL && rules->s != NULL;
+    has[RULE_CONTRAPOSITION] = has[RULE_SYLLOGISM] && rules->n != NULL;
+
+    for (int rule = 0; rule < RULE_COUNT; rule++) {
+        if (!(enabled & (1u << rule))) continue;
+
+        if (has[rule]) rules->enabled |= 1u << rule;
+        else fprintf(stderr, "rule %s disabled: its axioms are missing\n", rule_names[rule]);
+    }
+}
+
+/* Same rules as proto with an empty index, for another thread. */
+void Rules_InitFrom(rules_t *rules, rules_t *proto)
+{
+    memset(rules, 0, sizeof(rules_t));
+    antecedent_map_init(&rules->antecedents);
+    rules->enabled = proto->enabled;
+    rules->k = proto->k;
+    rules->s = proto->s;
+    rules->n = proto->n;
+}
+
+void Rules_Free(rules_t *rules)
+{
+    antecedent_map_cleanup(&rules->antecedents);
+    free(rules->links);
+    memset(rules, 0, sizeof(rules_t));
+}
+
+/* Forgets the indexed implications; the enabled rules stay. */
+void Rules_Reset(rules_t *rules)
+{
+    antecedent_map_clear(&rules->antecedents);
+    rules->link_count = 0;
+}
+
+/* Records a pool implication under its antecedent. */
+void Rules_Index(rules_t *rules, expr_t *e)
+{
+    if (rules->enabled == 0 || e->type != EXPR_IMPLIES) return;
+
+    if (rules->link_count == rules->link_cap) {
+        rules->link_cap = rules->link_cap ? rules->link_cap * 2 : 1024;
+        rules->links = realloc(rules->links, rules->link_cap * sizeof(rule_link_t));
+        if (rules->links == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+
+    antecedent_map_itr iter = antecedent_map_get_or_insert(&rules->antecedents, e->implies.a, -1);
+    rules->links[rules->link_count] = (rule_link_t){ e, iter.data->val };
+    iter.data->val = rules->link_count++;
+}
+
+/*
+ * A conclusion is only worth adding if the goal mentions it or some pool
+ * implication can consume it by MP; everything else would just grow the
+ * transitive closure of the pool.
+ */
+static bool Useful(rules_t *rules, expr_t *e)
+{
+    return FindExprInTerms(e) != NULL ||
+           !antecedent_map_is_end(antecedent_map_get(&rules->antecedents, e));
+}
+
+/* Probes for (a => b) without allocating it. */
+static bool Wanted(rules_t *rules, expr_t *a, expr_t *b)
+{
+    expr_t probe;
+    memset(&probe, 0, sizeof(probe));
+    probe.type = EXPR_IMPLIES;
+    probe.implies.a = a;
+    probe.implies.b = b;
+
+    return FindExprInPool(&probe) == NULL && Useful(rules, &probe);
+}
+
+/*
+ * Fires the enabled rules with the pool implication e as first premise and
+ * fills te with the first new, useful conclusion. Returns false if there
+ * is none.
+ */
+bool Rules_Fire(rules_t *rules, expr_t *e, true_expr_t *te)
+{
+    if (e->type != EXPR_IMPLIES) return false;
+    expr_t *A = e->implies.a;
+    expr_t *B = e->implies.b;
+
+    if (rules->enabled & (1u << RULE_SYLLOGISM)) {
+        antecedent_map_itr iter = antecedent_map_get(&rules->antecedents, B);
+        for (int l = antecedent_map_is_end(iter) ? -1 : iter.data->val; l >= 0; l = rules->links[l].next) {
+            expr_t *B_impl_C = rules->links[l].e;
+            if (Wanted(rules, A, B_impl_C->implies.b)) {
+                TrueExpr_Init(te, Expr_Implies(A, B_impl_C->implies.b));
+                TrueExpr_Rule(te, RULE_SYLLOGISM, SYLLOGISM_STEPS, e, B_impl_C);
+                return true;
+            }
+        }
+    }
+
+    if ((rules->enabled & (1u << RULE_CONTRAPOSITION)) && A->type == EXPR_NOT && B->type == EXPR_NOT) {
+        if (Wanted(rules, B->not.a, A->not.a)) {
+            TrueExpr_Init(te, Expr_Implies(B->not.a, A->not.a));
+            TrueExpr_Rule(te, RULE_CONTRAPOSITION, CONTRAPOSITION_STEPS, e, NULL);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int EmitAxiom(proof_builder_t *b, expr_t *e, expr_t *axiom, expr_t *A, expr_t *B, expr_t *C)
+{
+    proof_step_t step;
+    step.e = e;
+    step.type = INFERENCE_AXIOM;
+    step.axiom = (axiom_inst_t){ axiom, A, B, C };
+    return Proof_Emit(b, &step, true);
+}
+
+static int EmitModusPonens(proof_builder_t *b, expr_t *e, int A_impl_B, int A, bool reuse)
+{
+    proof_step_t step;
+    step.e = e;
+    step.type = INFERENCE_MODUS_PONENS;
+    step.modus_ponens.A_impl_B = A_impl_B;
+    step.modus_ponens.A = A;
+    return Proof_Emit(b, &step, reuse);
+}
+
+/*
+ *   1 (B => C) => (A => (B => C))                        K
+ *   2 A => (B => C)                                      MP 1, B => C
+ *   3 (A => (B => C)) => ((A => B) => (A => C))          S
+ *   4 (A => B) => (A => C)                               MP 3, 2
+ *   5 A => C                                             MP 4, A => B
+ */
+static int EmitSyllogism(rules_t *rules, proof_builder_t *b, int ab, int bc, expr_t *ac, bool reuse)
+{
+    expr_t *A_impl_B = b->proof->steps[ab].e;
+    expr_t *B_impl_C = b->proof->steps[bc].e;
+    expr_t *A = A_impl_B->implies.a;
+    expr_t *B = A_impl_B->implies.b;
+    expr_t *C = B_impl_C->implies.b;
+
+    expr_t *A_impl_BC = Expr_Implies(A, B_impl_C);
+    int s1 = EmitAxiom(b, Expr_Implies(B_impl_C, A_impl_BC), rules->k, B_impl_C, A, C);
+    int s2 = EmitModusPonens(b, A_impl_BC, s1, bc, true);
+
+    expr_t *AB_impl_AC = Expr_Implies(A_impl_B, ac);
+    int s3 = EmitAxiom(b, Expr_Implies(A_impl_BC, AB_impl_AC), rules->s, A, B, C);
+    int s4 = EmitModusPonens(b, AB_impl_AC, s3, s2, true);
+    return EmitModusPonens(b, ac, s4, ab, reuse);
+}
+
+/*
+ *   1 (!B => !A) => ((!B => A) => B)                     N
+ *   2 (!B => A) => B                                     MP 1, !B => !A
+ *   3 A => (!B => A)                                     K
+ *   4 A => B                                             syllogism 3, 2
+ */
+static int EmitContraposition(rules_t *rules, proof_builder_t *b, int h, expr_t *ab, bool reuse)
+{
+    expr_t *nB_impl_nA = b->proof->steps[h].e;
+    expr_t *nB = nB_impl_nA->implies.a;
+    expr_t *A = ab->implies.a;
+    expr_t *B = ab->implies.b;
+
+    expr_t *nB_impl_A = Expr_Implies(nB, A);
+    expr_t *conclusion = Expr_Implies(nB_impl_A, B);
+    int s1 = EmitAxiom(b, Expr_Implies(nB_impl_nA, conclusion), rules->n, A, B, A);
+    int s2 = EmitModusPonens(b, conclusion, s1, h, true);
+    int s3 = EmitAxiom(b, Expr_Implies(A, nB_impl_A), rules->k, A, nB, A);
+    return EmitSyllogism(rules, b, s3, s2, ab, reuse);
+}
+
+/* Replaces every rule step with its expansion. */
+void Rules_Expand(rules_t *rules, proof_t *proof)
+{
+    int i = 0;
+    while (i < proof->count && proof->steps[i].type != INFERENCE_RULE) i++;
+    if (i == proof->count) return;
+
+    proof_t out;
+    Proof_Init(&out);
+
+    proof_builder_t b;
+    Proof_BuilderInit(&b, &out);
+
+    int *map = malloc(proof->count * sizeof(int));
+    for (i = 0; i < proof->count; i++) {
+        proof_step_t step = proof->steps[i];
+        bool reuse = i != proof->count - 1;
+
+        switch (step.type) {
+        case INFERENCE_RULE: {
+            int first = map[step.rule.premises[0]];
+            if (step.rule.rule == RULE_SYLLOGISM) {
+                map[i] = EmitSyllogism(rules, &b, first, map[step.rule.premises[1]], step.e, reuse);
+            }
+            else {
+                map[i] = EmitContraposition(rules, &b, first, step.e, reuse);
+            }
+            continue;
+        }
+        case INFERENCE_MODUS_PONENS:
+            step.modus_ponens.A_impl_B = map[step.modus_ponens.A_impl_B];
+            step.modus_ponens.A = map[step.modus_ponens.A];
+            break;
+        default:
+            break;
+        }
+        map[i] = Proof_Emit(&b, &step, reuse);
+    }
+
+    free(map);
+    Proof_BuilderFree(&b);
+    Proof_Free(proof);
+    *proof = out;
+}
@@ -0,0 +1,59 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include "proof.h"
+
+/*
+ * Derived inference rules. RunInference fires them as single steps, joined
+ * through an index of pool implications by antecedent, and Rules_Expand
+ * turns each into the axiom and MP steps that justify it, so printed and
+ * stored proofs stay checkable against the axioms alone. A rule is only
+ * enabled if the axioms its expansion needs were loaded:
+ *
+ *   syllogism       (A => B), (B => C) |- (A => C)    needs K, S
+ *   contraposition  (!B => !A) |- (A => B)            needs K, S, N
+ *
+ * with K = (A => (B => A)), S = ((A => (B => C)) => ((A => B) => (A => C)))
+ * and N = ((!B => !A) => ((!B => A) => B)).
+ */
+typedef enum {
+    RULE_SYLLOGISM,
+    RULE_CONTRAPOSITION,
+    RULE_COUNT
+} rule_id_t;
+
+#define RULES_ALL ((1u << RULE_COUNT) - 1)
+
+#define NAME antecedent_map
+#define KEY_TY expr_t*
+#define VAL_TY int
+#define HASH_FN Expr_Hash
+#define CMPR_FN Expr_Equal
+#include "verstable.h"
+
+typedef struct {
+    expr_t *e;
+    int next;
+} rule_link_t;
+
+typedef struct {
+    unsigned enabled;
+    expr_t *k, *s, *n;
+
+    antecedent_map antecedents;
+    rule_link_t *links;
+    int link_count;
+    int link_cap;
+} rules_t;
+
+int  Rules_Parse(const char *spec, unsigned *enabled);
+void Rules_Init(rules_t *rules, unsigned enabled, expr_t **axioms, int axiom_count);
+void Rules_InitFrom(rules_t *rules, rules_t *proto);
+void Rules_Free(rules_t *rules);
+void Rules_Reset(rules_t *rules);
+
+void Rules_Index(rules_t *rules, expr_t *e);
+bool Rules_Fire(rules_t *rules, expr_t *e, true_expr_t *te);
+void Rules_Expand(rules_t *rules, proof_t *proof);
+
+#endif
@@ -0,0 +1,243 @@
+#include "schema.h"
+#include "canon.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NAME subst_memo
+#define KEY_TY uint64_t
+#define VAL_TY expr_t*
+#include "verstable.h"
+
+static const char *schema_vars[] = { "A", "B", "C" };
+
+void Schema_Init(schema_list_t *list)
+{
+    list->items = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+void Schema_Free(schema_list_t *list)
+{
+    for (int i = 0; i < list->count; i++) {
+        Proof_Free(&list->items[i].proof);
+    }
+    free(list->items);
+    Schema_Init(list);
+}
+
+schema_t *Schema_Find(schema_list_t *list, expr_t *schema)
+{
+    for (int i = 0; i < list->count; i++) {
+        if (Expr_Equal(list->items[i].schema, schema)) return &list->items[i];
+    }
+    return NULL;
+}
+
+/*
+ * Generalizes the formula proven by proof, which must only use the given
+ * axioms. Formulas with more than three atoms, single-step proofs and
+ * schemas that are already known (as an axiom or as a derived schema) are
+ * skipped. Returns 0 if a schema was added.
+ */
+int Schema_Derive(schema_list_t *list, proof_t *proof, expr_t **axioms, int axiom_count)
+{
+    if (proof->count < 2) return -1;
+
+    renaming_t canon;
+    Canon_Init(&canon);
+    Canon_Build(&canon, proof->steps[proof->count - 1].e);
+    if (canon.count > 3) {
+        Canon_Free(&canon);
+        return -1;
+    }
+
+    renaming_t generalize;
+    Canon_Init(&generalize);
+    for (int i = 0; i < canon.count; i++) {
+        Canon_Add(&generalize, canon.from[i], schema_vars[i]);
+    }
+    Canon_Free(&canon);
+
+    schema_t s;
+    Proof_Init(&s.proof);
+    for (int i = 0; i < proof->count; i++) {
+        Proof_Push(&s.proof, &proof->steps[i]);
+    }
+    Canon_ApplyProof(&generalize, &s.proof);
+    Canon_Free(&generalize);
+    s.schema = s.proof.steps[s.proof.count - 1].e;
+
+    bool known = Schema_Find(list, s.schema) != NULL;
+    for (int i = 0; i < axiom_count && !known; i++) {
+        known = Expr_Equal(axioms[i], s.schema);
+    }
+    if (known) {
+        Proof_Free(&s.proof);
+        return -1;
+    }
+
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 16;
+        list->items = realloc(list->items, list->capacity * sizeof(schema_t));
+        if (list->items == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+    list->items[list->count++] = s;
+    return 0;
+}
+
+typedef struct {
+    subst_memo memo;
+    expr_t *sub[3];
+} subst_t;
+
+typedef struct {
+    expr_t *e;
+    int state;
+} subst_frame_t;
+
+/* Rebuilds only the nodes whose children changed; results are memoized by address. */
+static expr_t *Substitute(subst_t *st, expr_t *e)
+{
+    if (e == NULL) return NULL;
+
+    subst_frame_t frames_local[64];
+    subst_frame_t *frames = frames_local;
+    int sp = 0, cap = 64;
+
+    expr_t *values_local[64];
+    expr_t **values = values_local;
+    int vp = 0, vcap = 64;
+
+    frames[sp++] = (subst_frame_t){ e, 0 };
+    while (sp > 0) {
+        subst_frame_t *f = &frames[sp - 1];
+        e = f->e;
+
+        if (vp + 1 > vcap) values = Expr_GrowStack(values, values_local, &vcap, sizeof(expr_t *));
+
+        if (f->state == 0) {
+            subst_memo_itr iter = subst_memo_get(&st->memo, (uintptr_t)e);
+            if (!subst_memo_is_end(iter)) {
+                values[vp++] = iter.data->val;
+                sp--;
+                continue;
+            }
+            if (e->type != EXPR_ATOM) {
+                f->state = 1;
+                if (sp + 2 > cap) frames = Expr_GrowStack(frames, frames_local, &cap, sizeof(subst_frame_t));
+                if (e->type == EXPR_IMPLIES) {
+                    frames[sp++] = (subst_frame_t){ e->implies.b, 0 };
+                    frames[sp++] = (subst_frame_t){ e->implies.a, 0 };
+                }
+                else {
+                    frames[sp++] = (subst_frame_t){ e->not.a, 0 };
+                }
+                continue;
+            }
+        }
+        sp--;
+
+        expr_t *res = e;
+        switch (e->type) {
+        case EXPR_IMPLIES: {
+            expr_t *b = values[--vp];
+            expr_t *a = values[--vp];
+            if (a != e->implies.a || b != e->implies.b) res = Expr_Implies(a, b);
+            break;
+        }
+        case EXPR_NOT: {
+            expr_t *a = values[--vp];
+            if (a != e->not.a) res = Expr_Not(a);
+            break;
+        }
+        case EXPR_ATOM:
+            for (int i = 0; i < 3; i++) {
+                if (st->sub[i] != NULL && strcmp(e->atom.name, schema_vars[i]) == 0) res = st->sub[i];
+            }
+            break;
+        }
+
+        subst_memo_insert(&st->memo, (uintptr_t)e, res);
+        values[vp++] = res;
+    }
+
+    expr_t *res = values[0];
+    if (frames != frames_local) free(frames);
+    if (values != values_local) free(values);
+    return res;
+}
+
+/* Emits the proof of s instantiated with the bindings of an axiom step. */
+static int EmitInstance(proof_builder_t *b, schema_t *s, axiom_inst_t *inst, bool goal)
+{
+    subst_t st;
+    subst_memo_init(&st.memo);
+    st.sub[0] = inst->A;
+    st.sub[1] = inst->B;
+    st.sub[2] = inst->C;
+
+    int *map = malloc(s->proof.count * sizeof(int));
+    for (int j = 0; j < s->proof.count; j++) {
+        proof_step_t step = s->proof.steps[j];
+        step.e = Substitute(&st, step.e);
+        if (step.type == INFERENCE_AXIOM) {
+            step.axiom.A = Substitute(&st, step.axiom.A);
+            step.axiom.B = Substitute(&st, step.axiom.B);
+            step.axiom.C = Substitute(&st, step.axiom.C);
+        }
+        else {
+            step.modus_ponens.A_impl_B = map[step.modus_ponens.A_impl_B];
+            step.modus_ponens.A = map[step.modus_ponens.A];
+        }
+        map[j] = Proof_Emit(b, &step, !goal || j != s->proof.count - 1);
+    }
+
+    int res = map[s->proof.count - 1];
+    free(map);
+    subst_memo_cleanup(&st.memo);
+    return res;
+}
+
+/*
+ * Replaces every step justified by a derived schema with the instantiated
+ * proof of that schema. Formulas already emitted are reused, so lemmas
+ * sharing steps don't repeat them.
+ */
+void Schema_Expand(schema_list_t *list, proof_t *proof)
+{
+    if (list->count == 0) return;
+
+    proof_t out;
+    Proof_Init(&out);
+
+    proof_builder_t b;
+    Proof_BuilderInit(&b, &out);
+
+    int *map = malloc(proof->count * sizeof(int));
+    for (int i = 0; i < proof->count; i++) {
+        proof_step_t step = proof->steps[i];
+        bool goal = i == proof->count - 1;
+
+        schema_t *s = step.type == INFERENCE_AXIOM ? Schema_Find(list, step.axiom.axiom) : NULL;
+        if (s != NULL) {
+            map[i] = EmitInstance(&b, s, &step.axiom, goal);
+            continue;
+        }
+
+        if (step.type == INFERENCE_MODUS_PONENS) {
+            step.modus_ponens.A_impl_B = map[step.modus_ponens.A_impl_B];
+            step.modus_ponens.A = map[step.modus_ponens.A];
+        }
+        map[i] = Proof_Emit(&b, &step, !goal);
+    }
+
+    free(map);
+    Proof_BuilderFree(&b);
+    Proof_Free(proof);
+    *proof = out;
+}
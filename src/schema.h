@@ -0,0 +1,32 @@
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include "proof.h"
+
+/*
+ * Schemas derived from proven formulas. A formula over at most three atoms
+ * is generalized by replacing its atoms with the schema variables A, B, C
+ * (e.g. (p => p) becomes (A => A)); substituting into every step of its
+ * proof proves any instance of it, so the schema can be instantiated like
+ * an axiom and expanded back into axiom and MP steps when the proof is
+ * extracted.
+ */
+typedef struct {
+    expr_t *schema;
+    proof_t proof;
+} schema_t;
+
+typedef struct {
+    schema_t *items;
+    int count;
+    int capacity;
+} schema_list_t;
+
+void Schema_Init(schema_list_t *list);
+void Schema_Free(schema_list_t *list);
+
+int       Schema_Derive(schema_list_t *list, proof_t *proof, expr_t **axioms, int axiom_count);
+schema_t *Schema_Find(schema_list_t *list, expr_t *schema);
+void      Schema_Expand(schema_list_t *list, proof_t *proof);
+
+#endif
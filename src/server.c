@@ -0,0 +1,336 @@
+#include "server.h"
+#include "parser.h"
+#include "source.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define READ_CHUNK 4096
+#define SERVER_SLICE 20000
+/* Longest goal line read, in bytes; roomy enough for PARSER_MAX_DEPTH. */
+#define SERVER_MAX_LINE (1 << 20)
+/* Unsent reply bytes at which a client is no longer read or served. */
+#define SERVER_MAX_BACKLOG (1 << 20)
+
+typedef struct {
+    int fd;
+    char *in;
+    size_t in_len;
+    size_t in_pos;
+    size_t in_cap;
+    writer_t reply;
+    size_t sent;
+    int goals;
+    prover_ctx_t *prover;
+    bool busy;
+    bool eof;
+    bool skipping;
+    bool dead;
+} client_t;
+
+static volatile sig_atomic_t stopping = 0;
+
+static void Stop(int sig)
+{
+    (void)sig;
+    stopping = 1;
+}
+
+static int SetNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+static int Listen(const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0 ||
+        SetNonBlocking(fd) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void Accept(int lfd, client_t **clients, int *count, int *capacity)
+{
+    for (;;) {
+        int fd = accept(lfd, NULL, NULL);
+        if (fd < 0) return;
+
+        if (SetNonBlocking(fd) != 0) {
+            close(fd);
+            continue;
+        }
+        if (*count == *capacity) {
+            *capacity = *capacity ? *capacity * 2 : 16;
+            *clients = realloc(*clients, *capacity * sizeof(client_t));
+            if (*clients == NULL) {
+                fprintf(stderr, "Out of memory\n");
+                exit(1);
+            }
+        }
+
+        client_t *c = &(*clients)[(*count)++];
+        memset(c, 0, sizeof(client_t));
+        c->fd = fd;
+        Writer_Init(&c->reply, -1);
+    }
+}
+
+static bool Backlogged(client_t *c)
+{
+    return c->reply.len - c->sent >= SERVER_MAX_BACKLOG;
+}
+
+/* Input is read until a full line's worth is pending or the reply backs up. */
+static bool Reading(client_t *c)
+{
+    return !c->eof && c->in_len - c->in_pos < SERVER_MAX_LINE && !Backlogged(c);
+}
+
+static void Receive(client_t *c)
+{
+    for (;;) {
+        if (c->in_pos > 0 && c->in_pos == c->in_len) {
+            c->in_pos = c->in_len = 0;
+        }
+        if (!Reading(c)) return;
+        if (c->in_len + READ_CHUNK > c->in_cap) {
+            if (c->in_pos > 0) {
+                memmove(c->in, c->in + c->in_pos, c->in_len - c->in_pos);
+                c->in_len -= c->in_pos;
+                c->in_pos = 0;
+            }
+            while (c->in_len + READ_CHUNK > c->in_cap) {
+                c->in_cap = c->in_cap ? c->in_cap * 2 : READ_CHUNK;
+            }
+            c->in = realloc(c->in, c->in_cap);
+            if (c->in == NULL) {
+                fprintf(stderr, "Out of memory\n");
+                exit(1);
+            }
+        }
+
+        ssize_t n = read(c->fd, c->in + c->in_len, c->in_cap - c->in_len);
+        if (n > 0) {
+            c->in_len += n;
+            if (c->skipping) {
+                /* The rest of an overlong line is dropped up to its newline. */
+                char *nl = memchr(c->in + c->in_pos, '\n', c->in_len - c->in_pos);
+                if (nl == NULL) c->in_len = c->in_pos;
+                else c->in_pos = nl + 1 - c->in;
+                c->skipping = nl == NULL;
+            }
+            continue;
+        }
+        if (n == 0) c->eof = true;
+        else if (errno == EINTR) continue;
+        else if (errno != EAGAIN && errno != EWOULDBLOCK) c->dead = true;
+        return;
+    }
+}
+
+static void Send(client_t *c)
+{
+    while (c->sent < c->reply.len) {
+        ssize_t n = send(c->fd, c->reply.buf + c->sent, c->reply.len - c->sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) c->dead = true;
+            return;
+        }
+        c->sent += n;
+    }
+    c->reply.len = c->sent = 0;
+}
+
+/*
+ * Next complete line of the client's input; a last line without newline
+ * counts once the client is done writing. An unfinished line of
+ * SERVER_MAX_LINE bytes is returned as it stands and the rest of it is
+ * skipped, so the caller can reject it by its length.
+ */
+static bool NextLine(client_t *c, const char **begin, const char **end)
+{
+    if (c->in_pos >= c->in_len) return false;
+
+    char *line = c->in + c->in_pos;
+    char *nl = memchr(line, '\n', c->in_len - c->in_pos);
+    if (nl == NULL && !c->eof) {
+        if (c->in_len - c->in_pos < SERVER_MAX_LINE) return false;
+        c->skipping = true;
+    }
+
+    char *stop = nl != NULL ? nl : c->in + c->in_len;
+    *begin = line;
+    *end = stop;
+    c->in_pos = stop - c->in + (nl != NULL);
+    return true;
+}
+
+static bool HasLine(client_t *c)
+{
+    if (c->in_pos >= c->in_len) return false;
+    if (c->in_len - c->in_pos >= SERVER_MAX_LINE) return true;
+    return c->eof || memchr(c->in + c->in_pos, '\n', c->in_len - c->in_pos) != NULL;
+}
+
+/*
+ * Gives the client one slice of search: starts its next queued goal if it
+ * has none under way, and writes the record once the goal is done. Returns
+ * false if the client had nothing to do.
+ */
+static bool ServeSlice(prover_ctx_t *root, client_t *c, bool history, long slice)
+{
+    if (c->dead) return false;
+
+    prover_status_t status;
+    if (c->busy) {
+        status = Prover_Step(c->prover, slice);
+    }
+    else {
+        if (Backlogged(c)) return false;
+
+        const char *begin, *end;
+        do {
+            if (!NextLine(c, &begin, &end)) return false;
+        } while (Source_SkipLine(begin, end));
+
+        int n = ++c->goals;
+        const char *expected = end - begin >= SERVER_MAX_LINE ? "a shorter line" : Parser_Check(begin, end);
+        if (expected != NULL) {
+            Prover_WriteErrorRecord(&c->reply, n, expected);
+            return true;
+        }
+
+        if (c->prover == NULL) c->prover = Prover_CreateShared(root);
+        Prover_SetGoal(c->prover, begin, end);
+        status = Prover_Start(c->prover);
+        c->busy = true;
+    }
+
+    if (status == PROVER_RUNNING) return true;
+
+    Prover_WriteRecord(c->prover, &c->reply, c->goals, history);
+    Prover_Reset(c->prover);
+    c->busy = false;
+    return true;
+}
+
+static bool Finished(client_t *c)
+{
+    return c->dead || (c->eof && !c->busy && c->in_pos >= c->in_len && c->reply.len == 0);
+}
+
+static void Drop(client_t *c)
+{
+    close(c->fd);
+    free(c->in);
+    Writer_Free(&c->reply);
+    if (c->prover != NULL) Prover_Destroy(c->prover);
+}
+
+int Server_Run(prover_ctx_t *ctx, const char *path, bool history, long slice)
+{
+    if (slice <= 0) slice = SERVER_SLICE;
+
+    int lfd = Listen(path);
+    if (lfd < 0) return 1;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = Stop;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    client_t *clients = NULL;
+    int count = 0, capacity = 0;
+    struct pollfd *fds = NULL;
+    int fds_cap = 0;
+    int turn = 0;
+    int failed = 0;
+
+    while (!stopping) {
+        if (count + 1 > fds_cap) {
+            fds_cap = (count + 1) * 2;
+            fds = realloc(fds, fds_cap * sizeof(struct pollfd));
+            if (fds == NULL) {
+                fprintf(stderr, "Out of memory\n");
+                exit(1);
+            }
+        }
+
+        bool queued = false;
+        fds[0] = (struct pollfd){ lfd, POLLIN, 0 };
+        for (int i = 0; i < count; i++) {
+            client_t *c = &clients[i];
+            short events = (Reading(c) ? POLLIN : 0) | (c->reply.len > 0 ? POLLOUT : 0);
+            fds[i + 1] = (struct pollfd){ c->fd, events, 0 };
+            queued |= c->busy || (HasLine(c) && !Backlogged(c));
+        }
+
+        int polled = count;
+        if (poll(fds, polled + 1, queued ? 0 : -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            failed = 1;
+            break;
+        }
+
+        for (int i = 0; i < polled; i++) {
+            short revents = fds[i + 1].revents;
+            if (revents & (POLLIN | POLLHUP | POLLERR)) Receive(&clients[i]);
+            if (revents & POLLOUT) Send(&clients[i]);
+        }
+        if (fds[0].revents & POLLIN) Accept(lfd, &clients, &count, &capacity);
+
+        for (int k = 0; k < count; k++) {
+            int i = (turn + k) % count;
+            if (ServeSlice(ctx, &clients[i], history, slice)) {
+                Send(&clients[i]);
+                turn = i + 1;
+                break;
+            }
+        }
+
+        int kept = 0;
+        for (int i = 0; i < count; i++) {
+            if (Finished(&clients[i])) Drop(&clients[i]);
+            else clients[kept++] = clients[i];
+        }
+        count = kept;
+    }
+
+    for (int i = 0; i < count; i++) Drop(&clients[i]);
+    free(clients);
+    free(fds);
+    close(lfd);
+    unlink(path);
+    return failed;
+}
@@ -0,0 +1,22 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "prover.h"
+
+/*
+ * Prover daemon on a Unix domain socket. Clients write goals one per line
+ * and read back one record per goal (see Prover_WriteRecord), numbered per
+ * connection and in request order; a goal that fails Parser_Check, e.g.
+ * one nested deeper than PARSER_MAX_DEPTH, gets an ERROR record instead,
+ * as does a line of 1 MiB or more. A client that leaves 1 MiB of replies
+ * unread is neither read from nor served until it catches up.
+ * Connections are multiplexed with poll(2) on one thread. Each client
+ * proves its goals in its own context, sharing the axioms, rules, schemas
+ * and lemma database of ctx, and the clients with work take turns of slice
+ * steps each (see Prover_Step; 0 picks a default), so a hard goal of one
+ * client does not hold up the easy goals of the others. Runs until SIGINT
+ * or SIGTERM, then removes the socket.
+ */
+int Server_Run(prover_ctx_t *ctx, const char *path, bool history, long slice);
+
+#endif
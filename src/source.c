@@ -0,0 +1,98 @@
+#include "source.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define READ_CHUNK (1 << 16)
+
+static int ReadAll(source_t *src, int fd)
+{
+    size_t cap = READ_CHUNK;
+    char *buf = malloc(cap);
+
+    while (buf != NULL) {
+        if (src->size == cap) {
+            cap *= 2;
+            char *grown = realloc(buf, cap);
+            if (grown == NULL) break;
+            buf = grown;
+        }
+
+        ssize_t n = read(fd, buf + src->size, cap - src->size);
+        if (n < 0) break;
+        if (n == 0) {
+            src->base = buf;
+            return 0;
+        }
+        src->size += n;
+    }
+
+    free(buf);
+    src->size = 0;
+    return -1;
+}
+
+int Source_OpenFd(source_t *src, int fd)
+{
+    memset(src, 0, sizeof(source_t));
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base != MAP_FAILED) {
+            madvise(base, st.st_size, MADV_SEQUENTIAL);
+            src->base = base;
+            src->size = st.st_size;
+            src->mapped = true;
+            return 0;
+        }
+    }
+
+    return ReadAll(src, fd);
+}
+
+int Source_Open(source_t *src, const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    int res = Source_OpenFd(src, fd);
+    close(fd);
+    return res;
+}
+
+void Source_Close(source_t *src)
+{
+    if (src->mapped) munmap((void *)src->base, src->size);
+    else free((void *)src->base);
+    memset(src, 0, sizeof(source_t));
+}
+
+/* Next line without its newline; the last line need not end with one. */
+bool Source_NextLine(source_t *src, const char **begin, const char **end)
+{
+    if (src->offset >= src->size) return false;
+
+    const char *line = src->base + src->offset;
+    const char *nl = memchr(line, '\n', src->size - src->offset);
+    const char *stop = nl != NULL ? nl : src->base + src->size;
+
+    *begin = line;
+    *end = stop;
+    src->offset = stop - src->base + (nl != NULL);
+    return true;
+}
+
+/* Blank lines and lines starting with '#' carry no formula. */
+bool Source_SkipLine(const char *begin, const char *end)
+{
+    if (begin < end && begin[0] == '#') return true;
+
+    while (begin < end && isspace((unsigned char)*begin)) begin++;
+    return begin == end;
+}
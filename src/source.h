@@ -0,0 +1,27 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Read-only view of an input file. Regular files are mapped; anything
+ * else (a pipe on stdin) is read into memory once. Lines are handed out
+ * as [begin, end) ranges for Parser_InitRange, so there is no line length
+ * limit and nothing is copied.
+ */
+typedef struct {
+    const char *base;
+    size_t size;
+    size_t offset;
+    bool mapped;
+} source_t;
+
+int  Source_Open(source_t *src, const char *path);
+int  Source_OpenFd(source_t *src, int fd);
+void Source_Close(source_t *src);
+
+bool Source_NextLine(source_t *src, const char **begin, const char **end);
+bool Source_SkipLine(const char *begin, const char *end);
+
+#endif
@@ -0,0 +1,216 @@
+#include "stats.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+static const char *phase_names[PHASE_COUNT] = {
+    "parse", "terms", "lookup", "instantiate", "inference", "proof"
+};
+
+atomic_int stats_dump_requests;
+
+/* High-water resident set of the whole process in kB, 0 if unknown. */
+long Stats_PeakRss(void)
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_maxrss;
+}
+
+static void RequestDump(int sig)
+{
+    (void)sig;
+    atomic_fetch_add_explicit(&stats_dump_requests, 1, memory_order_relaxed);
+}
+
+void Stats_CatchSignal(int sig)
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = RequestDump;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(sig, &sa, NULL);
+}
+
+void Stats_Init(prover_stats_t *st)
+{
+    memset(st, 0, sizeof(prover_stats_t));
+}
+
+void Stats_Free(prover_stats_t *st)
+{
+    free(st->templates);
+    memset(st, 0, sizeof(prover_stats_t));
+}
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+void Stats_Merge(prover_stats_t *dst, prover_stats_t *src)
+{
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        dst->phases[p].wall_us += src->phases[p].wall_us;
+        dst->phases[p].cpu_us += src->phases[p].cpu_us;
+    }
+
+    dst->goals += src->goals;
+    dst->found += src->found;
+    dst->aborted += src->aborted;
+    dst->terms += src->terms;
+
+    for (int i = 0; i < src->template_count; i++) {
+        stats_template_t *t = Stats_Template(dst, i);
+        t->instances += src->templates[i].instances;
+        t->duplicates += src->templates[i].duplicates;
+    }
+
+    dst->mp_attempts += src->mp_attempts;
+    dst->mp_successes += src->mp_successes;
+    dst->rule_firings += src->rule_firings;
+    dst->restarts += src->restarts;
+    dst->passes += src->passes;
+
+    dst->peak_exprs = MAX(dst->peak_exprs, src->peak_exprs);
+    dst->peak_pool = MAX(dst->peak_pool, src->peak_pool);
+    dst->peak_terms = MAX(dst->peak_terms, src->peak_terms);
+}
+
+void Stats_Start(stats_clock_t *clock)
+{
+    clock_gettime(CLOCK_MONOTONIC, &clock->wall);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &clock->cpu);
+}
+
+static long Elapsed(struct timespec *since, struct timespec *now)
+{
+    return (now->tv_sec - since->tv_sec) * 1000000L + (now->tv_nsec - since->tv_nsec) / 1000;
+}
+
+void Stats_Stop(prover_stats_t *st, stats_phase_t phase, stats_clock_t *clock)
+{
+    stats_clock_t now;
+    Stats_Start(&now);
+    st->phases[phase].wall_us += Elapsed(&clock->wall, &now.wall);
+    st->phases[phase].cpu_us += Elapsed(&clock->cpu, &now.cpu);
+}
+
+stats_template_t *Stats_Template(prover_stats_t *st, int i)
+{
+    if (i >= st->template_count) {
+        st->templates = realloc(st->templates, (i + 1) * sizeof(stats_template_t));
+        if (st->templates == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+        memset(st->templates + st->template_count, 0, (i + 1 - st->template_count) * sizeof(stats_template_t));
+        st->template_count = i + 1;
+    }
+    return &st->templates[i];
+}
+
+static void WriteCounter(writer_t *w, const char *name, long value)
+{
+    Writer_Str(w, "    ");
+    Writer_Str(w, name);
+    Writer_Pad(w, ' ', 16 - (int)strlen(name));
+    Writer_Int(w, value, 0);
+    Writer_Char(w, '\n');
+}
+
+void Stats_Write(prover_stats_t *st, expr_t **templates, int template_count, writer_t *w)
+{
+    Writer_Str(w, "STATS:\n");
+    Writer_Str(w, "  phase           wall us      cpu us\n");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        Writer_Str(w, "    ");
+        Writer_Str(w, phase_names[p]);
+        Writer_Pad(w, ' ', 12 - (int)strlen(phase_names[p]));
+        Writer_Int(w, st->phases[p].wall_us, 12);
+        Writer_Int(w, st->phases[p].cpu_us, 12);
+        Writer_Char(w, '\n');
+    }
+
+    Writer_Str(w, "  goals\n");
+    WriteCounter(w, "goals", st->goals);
+    WriteCounter(w, "found", st->found);
+    WriteCounter(w, "aborted", st->aborted);
+    WriteCounter(w, "terms", st->terms);
+
+    Writer_Str(w, "  instantiate     instances  duplicates\n");
+    for (int i = 0; i < st->template_count && i < template_count; i++) {
+        Writer_Pad(w, ' ', 16);
+        Writer_Int(w, st->templates[i].instances, 9);
+        Writer_Int(w, st->templates[i].duplicates, 12);
+        Writer_Str(w, "  ");
+        Writer_Expr(w, templates[i]);
+        Writer_Char(w, '\n');
+    }
+
+    Writer_Str(w, "  inference\n");
+    WriteCounter(w, "mp_attempts", st->mp_attempts);
+    WriteCounter(w, "mp_successes", st->mp_successes);
+    WriteCounter(w, "rule_firings", st->rule_firings);
+    WriteCounter(w, "restarts", st->restarts);
+    WriteCounter(w, "passes", st->passes);
+
+    Writer_Str(w, "  memory\n");
+    WriteCounter(w, "peak_exprs", st->peak_exprs);
+    WriteCounter(w, "peak_pool", st->peak_pool);
+    WriteCounter(w, "peak_terms", st->peak_terms);
+    WriteCounter(w, "peak_rss_kb", Stats_PeakRss());
+    Writer_Char(w, '\n');
+}
+
+static void JsonField(writer_t *w, const char *name, long value, bool last)
+{
+    Writer_Char(w, '"');
+    Writer_Str(w, name);
+    Writer_Str(w, "\":");
+    Writer_Int(w, value, 0);
+    if (!last) Writer_Char(w, ',');
+}
+
+/* The same report as one line of JSON. */
+void Stats_WriteJson(prover_stats_t *st, expr_t **templates, int template_count, writer_t *w)
+{
+    Writer_Str(w, "{\"phases\":{");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        Writer_Char(w, '"');
+        Writer_Str(w, phase_names[p]);
+        Writer_Str(w, "\":{");
+        JsonField(w, "wall_us", st->phases[p].wall_us, false);
+        JsonField(w, "cpu_us", st->phases[p].cpu_us, true);
+        Writer_Str(w, p + 1 < PHASE_COUNT ? "}," : "}");
+    }
+    Writer_Str(w, "},");
+
+    JsonField(w, "goals", st->goals, false);
+    JsonField(w, "found", st->found, false);
+    JsonField(w, "aborted", st->aborted, false);
+    JsonField(w, "terms", st->terms, false);
+
+    Writer_Str(w, "\"templates\":[");
+    for (int i = 0; i < st->template_count && i < template_count; i++) {
+        if (i > 0) Writer_Char(w, ',');
+        Writer_Str(w, "{\"template\":\"");
+        Writer_Expr(w, templates[i]);
+        Writer_Str(w, "\",");
+        JsonField(w, "instances", st->templates[i].instances, false);
+        JsonField(w, "duplicates", st->templates[i].duplicates, true);
+        Writer_Char(w, '}');
+    }
+    Writer_Str(w, "],");
+
+    JsonField(w, "mp_attempts", st->mp_attempts, false);
+    JsonField(w, "mp_successes", st->mp_successes, false);
+    JsonField(w, "rule_firings", st->rule_firings, false);
+    JsonField(w, "restarts", st->restarts, false);
+    JsonField(w, "passes", st->passes, false);
+    JsonField(w, "peak_exprs", st->peak_exprs, false);
+    JsonField(w, "peak_pool", st->peak_pool, false);
+    JsonField(w, "peak_terms", st->peak_terms, false);
+    JsonField(w, "peak_rss_kb", Stats_PeakRss(), true);
+    Writer_Str(w, "}\n");
+}
@@ -0,0 +1,83 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "writer.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <time.h>
+
+/*
+ * Counters and timers of the search phases. Each context keeps its own;
+ * batch runs merge those of their contexts. Times are wall and thread CPU
+ * time in microseconds, summed over the slices a phase ran in.
+ */
+typedef enum {
+    PHASE_PARSE,
+    PHASE_TERMS,
+    PHASE_LOOKUP,
+    PHASE_INSTANTIATE,
+    PHASE_INFERENCE,
+    PHASE_PROOF,
+    PHASE_COUNT
+} stats_phase_t;
+
+typedef struct {
+    long wall_us;
+    long cpu_us;
+} stats_time_t;
+
+typedef struct {
+    struct timespec wall;
+    struct timespec cpu;
+} stats_clock_t;
+
+/* Per template, axioms first, then derived schemas. */
+typedef struct {
+    long instances;
+    long duplicates;
+} stats_template_t;
+
+typedef struct {
+    stats_time_t phases[PHASE_COUNT];
+
+    long goals;
+    long found;
+    long aborted;
+    long terms;
+
+    stats_template_t *templates;
+    int template_count;
+
+    long mp_attempts;
+    long mp_successes;
+    long rule_firings;
+    long restarts;
+    long passes;
+
+    long peak_exprs;
+    long peak_pool;
+    long peak_terms;
+} prover_stats_t;
+
+void Stats_Init(prover_stats_t *st);
+void Stats_Free(prover_stats_t *st);
+void Stats_Merge(prover_stats_t *dst, prover_stats_t *src);
+
+void Stats_Start(stats_clock_t *clock);
+void Stats_Stop(prover_stats_t *st, stats_phase_t phase, stats_clock_t *clock);
+stats_template_t *Stats_Template(prover_stats_t *st, int i);
+
+/*
+ * Bumped by the signal set up with Stats_CatchSignal. The search loops
+ * poll it and write a snapshot of the running search when it changes.
+ */
+extern atomic_int stats_dump_requests;
+
+void Stats_CatchSignal(int sig);
+
+long Stats_PeakRss(void);
+
+void Stats_Write(prover_stats_t *st, expr_t **templates, int template_count, writer_t *w);
+void Stats_WriteJson(prover_stats_t *st, expr_t **templates, int template_count, writer_t *w);
+
+#endif
@@ -11,9 +11,11 @@ typedef enum {
     TOK_ERR
 } token_type_t;
 
+/* Atoms are slices of the parser input, not copies. */
 typedef struct {
     token_type_t type;
-    char name[16];
+    const char *start;
+    int len;
 } token_t;
 
 void Token_Print(token_t *tok);
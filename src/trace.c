@@ -0,0 +1,92 @@
+#include "trace.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+bool trace_enabled = false;
+
+static writer_t trace;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static long trace_min_us;
+static bool trace_first;
+
+static atomic_int trace_threads;
+static _Thread_local int trace_tid;
+
+static long Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+int Trace_Open(const char *path, long min_us)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+
+    Writer_Init(&trace, fd);
+    Writer_Str(&trace, "{\"traceEvents\":[");
+    trace_min_us = min_us;
+    trace_first = true;
+    trace_enabled = true;
+    return 0;
+}
+
+void Trace_Close(void)
+{
+    if (!trace_enabled) return;
+
+    trace_enabled = false;
+    Writer_Str(&trace, "\n]}\n");
+    int fd = trace.fd;
+    Writer_Free(&trace);
+    close(fd);
+}
+
+void Trace_Begin(trace_span_t *span)
+{
+    span->start_us = trace_enabled ? Now() : 0;
+}
+
+/* Ends the span begun with Trace_Begin. formula and a negative count are left out. */
+void Trace_End(trace_span_t *span, const char *name, expr_t *formula, long count)
+{
+    if (!trace_enabled) return;
+
+    long dur = Now() - span->start_us;
+    if (dur < trace_min_us) return;
+
+    if (trace_tid == 0) trace_tid = atomic_fetch_add(&trace_threads, 1) + 1;
+
+    pthread_mutex_lock(&trace_lock);
+    Writer_Str(&trace, trace_first ? "\n" : ",\n");
+    trace_first = false;
+
+    Writer_Str(&trace, "{\"name\":\"");
+    Writer_Str(&trace, name);
+    Writer_Str(&trace, "\",\"ph\":\"X\",\"pid\":1,\"tid\":");
+    Writer_Int(&trace, trace_tid, 0);
+    Writer_Str(&trace, ",\"ts\":");
+    Writer_Int(&trace, span->start_us, 0);
+    Writer_Str(&trace, ",\"dur\":");
+    Writer_Int(&trace, dur, 0);
+    Writer_Str(&trace, ",\"args\":{");
+    if (formula != NULL) {
+        Writer_Str(&trace, "\"formula\":\"");
+        Writer_Expr(&trace, formula);
+        Writer_Str(&trace, count >= 0 ? "\"," : "\"");
+    }
+    if (count >= 0) {
+        Writer_Str(&trace, "\"count\":");
+        Writer_Int(&trace, count, 0);
+    }
+    Writer_Str(&trace, "}}");
+    pthread_mutex_unlock(&trace_lock);
+}
@@ -0,0 +1,25 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "writer.h"
+#include <stdbool.h>
+
+/*
+ * Chrome trace-event output (chrome://tracing, Perfetto). Spans are
+ * complete ("X") events on the thread that ran them, tagged with the
+ * formula worked on; spans shorter than the minimum are dropped. The
+ * trace is process-wide and safe to write from any thread.
+ */
+typedef struct {
+    long start_us;
+} trace_span_t;
+
+extern bool trace_enabled;
+
+int  Trace_Open(const char *path, long min_us);
+void Trace_Close(void);
+
+void Trace_Begin(trace_span_t *span);
+void Trace_End(trace_span_t *span, const char *name, expr_t *formula, long count);
+
+#endif
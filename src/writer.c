@@ -0,0 +1,171 @@
+#include "writer.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+_Thread_local writer_t out;
+
+void Writer_Init(writer_t *w, int fd)
+{
+    w->fd = fd;
+    w->error = 0;
+    w->len = 0;
+    w->cap = WRITER_BUFFER_SIZE;
+    w->buf = malloc(w->cap);
+    if (w->buf == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+}
+
+int Writer_Free(writer_t *w)
+{
+    int res = Writer_Flush(w);
+    free(w->buf);
+    w->buf = NULL;
+    w->len = w->cap = 0;
+    return res;
+}
+
+int Writer_Flush(writer_t *w)
+{
+    if (w->fd < 0) return 0;
+
+    size_t done = 0;
+    while (done < w->len && w->error == 0) {
+        ssize_t res = write(w->fd, w->buf + done, w->len - done);
+        if (res < 0) {
+            if (errno == EINTR) continue;
+            w->error = errno;
+            break;
+        }
+        done += res;
+    }
+    w->len = 0;
+    return w->error != 0 ? -1 : 0;
+}
+
+void Writer_Reserve(writer_t *w, size_t n)
+{
+    if (w->len + n <= w->cap) return;
+
+    Writer_Flush(w);
+    if (w->len + n <= w->cap) return;
+
+    /* A freed writer has no buffer left and grows from scratch. */
+    if (w->cap == 0) w->cap = WRITER_BUFFER_SIZE;
+    while (w->len + n > w->cap) w->cap *= 2;
+    w->buf = realloc(w->buf, w->cap);
+    if (w->buf == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+}
+
+void Writer_Put(writer_t *w, const char *s, size_t n)
+{
+    Writer_Reserve(w, n);
+    memcpy(w->buf + w->len, s, n);
+    w->len += n;
+}
+
+void Writer_Str(writer_t *w, const char *s)
+{
+    Writer_Put(w, s, strlen(s));
+}
+
+void Writer_Char(writer_t *w, char c)
+{
+    Writer_Reserve(w, 1);
+    w->buf[w->len++] = c;
+}
+
+void Writer_Pad(writer_t *w, char c, int n)
+{
+    if (n <= 0) return;
+    Writer_Reserve(w, n);
+    memset(w->buf + w->len, c, n);
+    w->len += n;
+}
+
+/* Same output as printf("%*ld", width, value). */
+void Writer_Int(writer_t *w, long value, int width)
+{
+    char tmp[24];
+    int len = 0;
+    unsigned long v = value < 0 ? -(unsigned long)value : (unsigned long)value;
+
+    do {
+        tmp[sizeof(tmp) - 1 - len++] = '0' + v % 10;
+        v /= 10;
+    } while (v != 0);
+    if (value < 0) tmp[sizeof(tmp) - 1 - len++] = '-';
+
+    Writer_Pad(w, ' ', width - len);
+    Writer_Put(w, tmp + sizeof(tmp) - len, len);
+}
+
+typedef struct {
+    expr_t *e;
+    char *p;
+} render_item_t;
+
+/*
+ * Every subterm knows its rendered length, so each one can be written at
+ * its final offset independently: an implication places both parentheses
+ * and the arrow right away and leaves its operands on the stack. Operands
+ * are still visited left to right, so output is written front to back.
+ */
+static void RenderExpr(char *p, expr_t *e)
+{
+    render_item_t local[64];
+    render_item_t *stack = local;
+    int sp = 0, cap = 64;
+    stack[sp++] = (render_item_t){ e, p };
+
+    while (sp > 0) {
+        render_item_t item = stack[--sp];
+        e = item.e;
+        p = item.p;
+        if (sp + 2 > cap) stack = Expr_GrowStack(stack, local, &cap, sizeof(render_item_t));
+
+        switch (e->type) {
+        case EXPR_IMPLIES: {
+            size_t a = Expr_Length(e->implies.a);
+            p[0] = '(';
+            memcpy(p + 1 + a, " => ", 4);
+            p[Expr_Length(e) - 1] = ')';
+            stack[sp++] = (render_item_t){ e->implies.b, p + 5 + a };
+            stack[sp++] = (render_item_t){ e->implies.a, p + 1 };
+            break;
+        }
+
+        case EXPR_NOT:
+            p[0] = '!';
+            stack[sp++] = (render_item_t){ e->not.a, p + 1 };
+            break;
+
+        case EXPR_ATOM:
+            memcpy(p, e->atom.name, Expr_Length(e));
+            break;
+        }
+    }
+
+    if (stack != local) free(stack);
+}
+
+/*
+ * The rendered length is cached in every subterm, so the whole formula is
+ * reserved once and rendered without further bounds checks. Returns the
+ * number of characters written.
+ */
+int Writer_Expr(writer_t *w, expr_t *e)
+{
+    size_t len = Expr_Length(e);
+    Writer_Reserve(w, len);
+    RenderExpr(w->buf + w->len, e);
+    w->len += len;
+    return len;
+}
@@ -0,0 +1,37 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include "expr.h"
+#include <stddef.h>
+
+/*
+ * Output buffer flushed with plain write(2) calls. A writer with fd < 0
+ * never flushes and just grows, which is used to render into memory. The
+ * first failed write is kept in error (an errno value); later output is
+ * dropped and Writer_Flush and Writer_Free report -1.
+ */
+typedef struct {
+    int fd;
+    int error;
+    char *buf;
+    size_t len;
+    size_t cap;
+} writer_t;
+
+#define WRITER_BUFFER_SIZE (1 << 20)
+
+extern _Thread_local writer_t out;
+
+void Writer_Init(writer_t *w, int fd);
+int  Writer_Free(writer_t *w);
+int  Writer_Flush(writer_t *w);
+void Writer_Reserve(writer_t *w, size_t n);
+
+void Writer_Put(writer_t *w, const char *s, size_t n);
+void Writer_Str(writer_t *w, const char *s);
+void Writer_Char(writer_t *w, char c);
+void Writer_Pad(writer_t *w, char c, int n);
+void Writer_Int(writer_t *w, long value, int width);
+int  Writer_Expr(writer_t *w, expr_t *e);
+
+#endif